@@ -5,6 +5,7 @@ in vec3 world_normal;
 in vec4 camera_pos;
 out vec4 fragColor;
 in vec2 fragUV;
+in float fragOcclusion; // baked corner occlusion, 0 (fully occluded) to 3 (open)
 
 
 struct Light {
@@ -21,9 +22,8 @@ uniform float ks;
 
 uniform sampler2D myTexture;
 
-uniform float xOffset;
-uniform float yOffset;
 uniform int lightLength;
+uniform float fadeDistance; // terrain fades out over the 10 units past this, follows the render distance
 
 
 uniform int lightTypes[100]; // specifies what type of light it is
@@ -36,7 +36,7 @@ uniform int blockID;
 
 void main() {
     float blend = 0.85f;
-    vec4 texCol = texture(myTexture, vec2(fragUV.x + xOffset, fragUV.y + yOffset));
+    vec4 texCol = texture(myTexture, fragUV);
     vec3 textureColor = vec3(texCol);
 
     vec3 lightDir;
@@ -71,7 +71,7 @@ void main() {
         float specular = pow(clamp(dot(toCamera, reflectedLight),0,100), 30);
 
         float distance = length(vec3(camera_pos) - vec3(world_pos));
-        float opacity = (distance > 25.f) ? 1.f - clamp((distance - 25.f) / 10.f, 0.f, 1.f): texCol[3];
+        float opacity = (distance > fadeDistance) ? 1.f - clamp((distance - fadeDistance) / 10.f, 0.f, 1.f): texCol[3];
         opacity = (blockID == 5) ? opacity * .4f : opacity;
 
         vec3 currentColor = lightColors[i];
@@ -80,4 +80,7 @@ void main() {
                         ka*textureColor + ks * specular)*currentColor, opacity)*attenuation;
 
     }
+
+    // Darken occluded corners, fully occluded corners keep 40% of their light
+    fragColor.rgb *= 0.4f + 0.2f * fragOcclusion;
 }
@@ -3,6 +3,7 @@
 layout (location = 0) in vec3 pos;
 layout(location = 1) in vec3 objectSpaceNormal;
 layout(location = 2) in vec2 UV;
+layout(location = 3) in float occlusion;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
@@ -13,6 +14,7 @@ out vec3 world_pos;
 out vec3 world_normal;
 out vec4 camera_pos;
 out vec2 fragUV;
+out float fragOcclusion;
 
 void main() {
    gl_Position = projMatrix * viewMatrix * modelMatrix * vec4(pos,1.0);
@@ -20,4 +22,5 @@ void main() {
    world_normal = transpose(inverse(mat3(modelMatrix))) * normalize((objectSpaceNormal));
    camera_pos = inverse(viewMatrix) * vec4(0,0,0,1);
    fragUV = UV;
+   fragOcclusion = occlusion;
 }
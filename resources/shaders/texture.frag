@@ -9,6 +9,10 @@ uniform sampler2D myTexture;
 
 // Task 29: Add a bool on whether or not to filter the texture
 uniform bool postProcessing;
+
+// Sharpening applied when the scene was rendered below native resolution and is being upscaled
+uniform float sharpness;
+uniform vec2 texelSize;
 out vec4 fragColor;
 
 void main()
@@ -16,11 +20,19 @@ void main()
     fragColor = vec4(1);
     // Task 17: Set fragColor using the sampler2D at the UV coordinate
     fragColor = texture(myTexture, vec2(fragUV));
+    if(sharpness > 0.0){
+        // Unsharp mask to recover some of the detail lost by the bilinear upscale
+        vec3 blur = (texture(myTexture, fragUV + vec2(texelSize.x, 0.0)).rgb +
+                     texture(myTexture, fragUV - vec2(texelSize.x, 0.0)).rgb +
+                     texture(myTexture, fragUV + vec2(0.0, texelSize.y)).rgb +
+                     texture(myTexture, fragUV - vec2(0.0, texelSize.y)).rgb) * 0.25;
+        fragColor.rgb = clamp(fragColor.rgb + sharpness * (fragColor.rgb - blur), 0.0, 1.0);
+    }
     // Task 33: Invert fragColor's r, g, and b color channels if your bool is true
     if(postProcessing){
-                fragColor.x = fragColor.x;
-                fragColor.y = fragColor.y;
-                fragColor.z = fragColor.z;
+                fragColor.x = 1.0 - fragColor.x;
+                fragColor.y = 1.0 - fragColor.y;
+                fragColor.z = 1.0 - fragColor.z;
     }
 
 }
@@ -0,0 +1,279 @@
+#include "benchmark.h"
+#include "chunkmesher.h"
+#include "collision.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+void Benchmark::runMeshing(const TerrainGenerator &generator, int iterations) {
+    ChunkMesher mesher(generator);
+    const auto &chunks = generator.getChunkMatrices();
+
+    for (bool ambientOcclusion : {true, false}) {
+        mesher.ambientOcclusion = ambientOcclusion;
+        size_t vertexCount = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (const auto &chunk : chunks) {
+                ChunkMesh mesh = mesher.buildMesh(chunk.key.first, chunk.key.second);
+                for (const SectionMesh &section : mesh.sections) {
+                    vertexCount += section.opaqueVertices.size() + section.waterVertices.size();
+                }
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        int meshed = chunks.count() * iterations;
+        std::cout << "Meshing (AO " << (ambientOcclusion ? "on" : "off") << "): " << meshed << " chunks in "
+                  << ms << " ms, " << ms / std::max(meshed, 1) << " ms per chunk, "
+                  << vertexCount / ChunkMesher::floatsPerVertex / std::max(iterations, 1) << " vertices" << std::endl;
+    }
+}
+
+void Benchmark::runJobScaling(const TerrainGenerator &generator, int iterations) {
+    ChunkMesher mesher(generator);
+    const auto &chunks = generator.getChunkMatrices();
+    int maxWorkers = std::min(std::max((int) std::thread::hardware_concurrency(), 1), 32);
+
+    double baseline = 0;
+    for (int workers = 1; workers <= maxWorkers; workers *= 2) {
+        JobSystem jobs(workers);
+        jobs.takeStats();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            std::vector<JobHandle> meshing;
+            for (const auto &chunk : chunks) {
+                meshing.push_back(jobs.submit([&mesher, key = chunk.key] {
+                    mesher.buildMesh(key.first, key.second);
+                }));
+            }
+            jobs.wait(jobs.submit([] {}, 0, meshing));
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (workers == 1) {
+            baseline = ms;
+        }
+
+        std::cout << "Job scaling (" << workers << " workers): " << chunks.count() * iterations << " chunks in "
+                  << ms << " ms, speedup " << baseline / ms << std::endl;
+        printWorkerStats(jobs);
+    }
+}
+
+namespace {
+
+template<typename Section>
+using SectionList = std::vector<std::pair<std::tuple<int, int, int>, const Section*>>;
+
+// Every loaded section with any blocks, keyed by chunk and section index.
+SectionList<ChunkSection> getLoadedSections(const TerrainGenerator &generator) {
+    SectionList<ChunkSection> sections;
+    for (const auto &chunk : generator.getChunkMatrices()) {
+        for (int index = 0; index < chunk.blocks.getSectionCount(); index++) {
+            if (!ChunkColumn::isEmpty(chunk.blocks.getSection(index))) {
+                sections.push_back({{chunk.key.first, chunk.key.second, index}, &chunk.blocks.getSection(index)});
+            }
+        }
+    }
+    return sections;
+}
+
+// Copies the sections into another storage, owned by copies. Uniform sections stay uniform so both
+// sides take the same paths.
+template<typename Section>
+SectionList<Section> copySections(const SectionList<ChunkSection> &sections, std::vector<std::unique_ptr<Section>> &copies) {
+    SectionList<Section> copied;
+    for (const auto &[key, section] : sections) {
+        int id = section->isUniform() ? section->get(0, 0, 0) : -1;
+        copies.push_back(std::make_unique<Section>(section->getWidth(), section->getHeight(), id));
+        if (!section->isUniform()) {
+            section->forEachBlock([&](int x, int y, int z, int id) { copies.back()->set(x, y, z, id); });
+        }
+        copied.push_back({key, copies.back().get()});
+    }
+    return copied;
+}
+
+// Times block reads, bulk iteration, a flood fill and meshing over the given sections, one line per test.
+template<typename Section>
+void timeSections(const char *name, const ChunkMesher &mesher, const SectionList<Section> &sections, int iterations) {
+    auto time = [&](const char *test, auto &&run) {
+        long checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            for (const auto &[key, section] : sections) {
+                checksum += run(key, *section);
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << name << " " << test << ": " << ms << " ms (checksum " << checksum << ")" << std::endl;
+    };
+
+    time("get", [](const auto &, const Section &section) {
+        long sum = 0;
+        for (int x = 0; x < section.getWidth(); x++) {
+            for (int y = 0; y < section.getWidth(); y++) {
+                for (int z = 0; z < section.getHeight(); z++) {
+                    sum += section.get(x, y, z);
+                }
+            }
+        }
+        return sum;
+    });
+    time("forEachBlock", [](const auto &, const Section &section) {
+        long sum = 0;
+        section.forEachBlock([&](int x, int y, int z, int id) { sum += x + y + z + id; });
+        return sum;
+    });
+
+    // Spreads through the air from the top layer the way sky light would, reading the neighbours of every block it reaches.
+    std::vector<bool> visited;
+    std::vector<glm::ivec3> queue;
+    time("flood fill", [&](const auto &, const Section &section) {
+        int width = section.getWidth();
+        int height = section.getHeight();
+        visited.assign(section.getBlockCount(), false);
+        queue.clear();
+        auto push = [&](glm::ivec3 p) {
+            if (p.x < 0 || p.y < 0 || p.z < 0 || p.x >= width || p.y >= width || p.z >= height) return;
+            int index = (p.x * width + p.y) * height + p.z;
+            if (visited[index] || section.get(p.x, p.y, p.z) != -1) return;
+            visited[index] = true;
+            queue.push_back(p);
+        };
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < width; y++) {
+                push({x, y, height - 1});
+            }
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            glm::ivec3 p = queue[i];
+            push(p + glm::ivec3(1, 0, 0));
+            push(p - glm::ivec3(1, 0, 0));
+            push(p + glm::ivec3(0, 1, 0));
+            push(p - glm::ivec3(0, 1, 0));
+            push(p + glm::ivec3(0, 0, 1));
+            push(p - glm::ivec3(0, 0, 1));
+        }
+        return (long) queue.size();
+    });
+
+    time("mesh", [&](const auto &key, const Section &section) {
+        auto [chunkX, chunkY, index] = key;
+        return (long) mesher.buildSectionMesh(chunkX, chunkY, index, section).opaqueVertices.size();
+    });
+}
+
+}
+
+void Benchmark::runSectionDimensions(const TerrainGenerator &generator, int iterations) {
+    ChunkMesher mesher(generator);
+    SectionList<ChunkSection> sections = getLoadedSections(generator);
+    std::vector<std::unique_ptr<DynamicChunkSection>> copies;
+    SectionList<DynamicChunkSection> dynamic = copySections(sections, copies);
+
+    std::cout << "Section dimensions: " << sections.size() << " sections, " << iterations << " iterations" << std::endl;
+    timeSections("fixed 8x8x8", mesher, sections, iterations);
+    timeSections("runtime sized", mesher, dynamic, iterations);
+}
+
+void Benchmark::runSectionLayouts(const TerrainGenerator &generator, int iterations) {
+    ChunkMesher mesher(generator);
+    SectionList<ChunkSection> sections = getLoadedSections(generator);
+    std::vector<std::unique_ptr<BasicChunkSection<8, 8, SectionLayout::linear>>> linearCopies;
+    std::vector<std::unique_ptr<MortonChunkSection>> mortonCopies;
+    auto linear = copySections(sections, linearCopies);
+    auto morton = copySections(sections, mortonCopies);
+
+    std::cout << "Section layouts: " << sections.size() << " sections, " << iterations << " iterations" << std::endl;
+    timeSections("linear", mesher, linear, iterations);
+    timeSections("morton", mesher, morton, iterations);
+}
+
+void Benchmark::runRaycasts(const TerrainGenerator &generator, int rays) {
+    const ChunkGrid &chunks = generator.getChunkMatrices();
+    std::vector<std::pair<int, int>> keys;
+    for (const auto &chunk : chunks) {
+        keys.push_back(chunk.key);
+    }
+    if (keys.empty()) {
+        return;
+    }
+
+    // Fixed seed so runs on the same world are comparable
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::normal_distribution<float> normal;
+    const int size = TerrainGenerator::chunkSize;
+    WorldView world(chunks);
+    std::vector<glm::vec3> origins(rays), directions(rays);
+    for (int i = 0; i < rays; i++) {
+        // From open space like the camera, not inside the terrain
+        do {
+            auto [chunkX, chunkY] = keys[random() % keys.size()];
+            int height = chunks.find({chunkX, chunkY})->getSectionCount() * ChunkColumn::sectionHeight;
+            glm::vec3 offset(unit(random) * size, unit(random) * size, unit(random) * (height + size));
+            origins[i] = TerrainGenerator::getBlockCenter(chunkX * size, chunkY * size, 0) - 0.5f + offset;
+        } while (world.isSolid(WorldView::getBlockAt(origins[i])));
+        directions[i] = glm::vec3(normal(random), normal(random), normal(random));
+    }
+
+    for (float maxDistance : {8.f, 64.f}) {
+        int hits = 0;
+        float distance = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rays; i++) {
+            RayHit hit;
+            if (raycast(world, origins[i], directions[i], maxDistance, hit)) {
+                hits++;
+                distance += hit.distance;
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Raycasts (up to " << maxDistance << " blocks): " << rays << " rays in " << ms << " ms, "
+                  << rays / std::max(ms, 1e-3) / 1000 << " million per second, " << hits << " hits at "
+                  << distance / std::max(hits, 1) << " blocks on average" << std::endl;
+    }
+}
+
+void Benchmark::printWorkerStats(JobSystem &jobs) {
+    std::vector<JobSystem::WorkerStats> stats = jobs.takeStats();
+    for (size_t i = 0; i < stats.size(); i++) {
+        std::cout << "  worker " << i << ": " << stats[i].utilisation * 100 << "% busy, "
+                  << stats[i].jobs << " jobs, " << stats[i].steals << " steals" << std::endl;
+    }
+}
+
+void Benchmark::printChunkMemory(const TerrainGenerator &generator) {
+    SlabPool::Stats pool = SlabPool::getStats();
+    std::cout << "Slab pool: " << pool.slabs << " slabs (" << pool.slabs * SlabPool::slabSize / 1024 << " KB), "
+              << pool.blocksInUse << " blocks in use (" << pool.bytesInUse / 1024 << " KB), "
+              << pool.heapAllocations << " heap allocations" << std::endl;
+
+    const auto &chunks = generator.getChunkMatrices();
+    if (chunks.count() == 0) {
+        return;
+    }
+    int minAllocations = INT_MAX, maxAllocations = 0, allocations = 0;
+    size_t minBytes = SIZE_MAX, maxBytes = 0, bytes = 0;
+    for (const auto &chunk : chunks) {
+        int chunkAllocations = chunk.blocks.getAllocationCount();
+        size_t chunkBytes = chunk.blocks.getBytes();
+        minAllocations = std::min(minAllocations, chunkAllocations);
+        maxAllocations = std::max(maxAllocations, chunkAllocations);
+        allocations += chunkAllocations;
+        minBytes = std::min(minBytes, chunkBytes);
+        maxBytes = std::max(maxBytes, chunkBytes);
+        bytes += chunkBytes;
+    }
+    std::cout << "Per chunk: " << minAllocations << " / " << allocations / chunks.count() << " / " << maxAllocations
+              << " allocations, " << minBytes << " / " << bytes / chunks.count() << " / " << maxBytes << " bytes" << std::endl;
+}
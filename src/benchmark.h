@@ -0,0 +1,33 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+#include "terraingenerator.h"
+#include "jobsystem.h"
+
+// In-game timing runs, started from GLRenderer with the B key. Results are printed to stdout.
+class Benchmark
+{
+public:
+    // Rebuilds the mesh of every loaded chunk with ambient occlusion on and off.
+    static void runMeshing(const TerrainGenerator &generator, int iterations = 10);
+
+    // Meshes every loaded chunk on job systems of 1, 2, 4 ... up to 32 workers, capped at the core count.
+    static void runJobScaling(const TerrainGenerator &generator, int iterations = 10);
+
+    // Reads and meshes every loaded section as the fixed size ChunkSection and as a runtime sized copy.
+    static void runSectionDimensions(const TerrainGenerator &generator, int iterations = 10);
+
+    // The same tests on copies of every loaded section in the linear and Morton layouts.
+    static void runSectionLayouts(const TerrainGenerator &generator, int iterations = 10);
+
+    // Casts rays from random points in the loaded chunks in random directions, as short as block picking
+    // and long enough to cross many sections.
+    static void runRaycasts(const TerrainGenerator &generator, int rays = 1000000);
+
+    // Utilisation, jobs run and steals of each worker since the last call.
+    static void printWorkerStats(JobSystem &jobs);
+
+    // SlabPool usage and the allocations and bytes of each loaded chunk, smallest, average and largest.
+    static void printChunkMemory(const TerrainGenerator &generator);
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,99 @@
+#include "chunkcache.h"
+#include <fstream>
+#include <random>
+#include <string>
+
+ChunkCache::ChunkCache(size_t maxBytes)
+    : maxBytes(maxBytes)
+{
+}
+
+ChunkCache::~ChunkCache() {
+    if (!m_directory.empty()) {
+        std::error_code error;
+        std::filesystem::remove_all(m_directory, error);
+    }
+}
+
+void ChunkCache::put(const std::pair<int, int> &key, ChunkBlocks blocks, bool modified) {
+    ChunkBlocks previous;
+    bool previousModified;
+    take(key, previous, previousModified);
+
+    size_t bytes = blocks.getBytes();
+    m_entries.push_front({key, std::move(blocks), bytes, modified});
+    m_index[key] = m_entries.begin();
+    m_bytes += bytes;
+    m_modifiedCount += modified;
+
+    while (m_bytes > maxBytes && !m_entries.empty()) {
+        Entry &oldest = m_entries.back();
+        if (oldest.modified) {
+            // Kept over budget rather than losing the edits when the file cannot be written
+            if (!spill(oldest)) {
+                break;
+            }
+            m_spilled.insert(oldest.key);
+            m_modifiedCount--;
+        } else {
+            evicted++;
+        }
+        m_bytes -= oldest.bytes;
+        m_index.erase(oldest.key);
+        m_entries.pop_back();
+    }
+}
+
+bool ChunkCache::take(const std::pair<int, int> &key, ChunkBlocks &blocks, bool &modified) {
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        blocks = std::move(it->second->blocks);
+        modified = it->second->modified;
+        m_bytes -= it->second->bytes;
+        m_modifiedCount -= modified;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+        return true;
+    }
+    if (m_spilled.erase(key) == 0) {
+        return false;
+    }
+    const std::filesystem::path path = getPath(key);
+    bool read;
+    {
+        std::ifstream file(path, std::ios::binary);
+        read = blocks.read(file);
+    }
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    modified = true;
+    return read;
+}
+
+bool ChunkCache::spill(const Entry &entry) {
+    std::error_code error;
+    if (m_directory.empty()) {
+        // A directory no other cache or process uses, so files of another world are never read back
+        const std::filesystem::path temp = std::filesystem::temp_directory_path(error);
+        if (error) {
+            return false;
+        }
+        std::random_device random;
+        std::filesystem::path directory;
+        do {
+            directory = temp / ("chunkcache-" + std::to_string(random()));
+        } while (!std::filesystem::create_directory(directory, error) && !error);
+        if (error) {
+            return false;
+        }
+        m_directory = directory;
+    }
+    std::ofstream file(getPath(entry.key), std::ios::binary | std::ios::trunc);
+    entry.blocks.write(file);
+    file.close();
+    return bool(file);
+}
+
+std::filesystem::path ChunkCache::getPath(const std::pair<int, int> &key) const {
+    return m_directory / (std::to_string(key.first) + "_" + std::to_string(key.second) + ".chunk");
+}
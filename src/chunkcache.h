@@ -0,0 +1,59 @@
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+#include <filesystem>
+#include <list>
+#include <map>
+#include <set>
+#include "chunkgrid.h"
+
+// Chunks that left the render window, kept in least recently used order up to a memory budget.
+// Their sections are already palette packed and uniform ones shared, which is smaller than any
+// encoding of the random terrain ids, so they are kept as they are and move back in without any
+// decoding. Chunk generation is deterministic, so an evicted chunk is simply generated again
+// if the player comes back. Modified chunks hold edits generation cannot bring back, they count
+// against the budget like the others but evicting one writes it to a file of its own, and take
+// reads it back from there.
+class ChunkCache
+{
+public:
+    // The files go in a new directory under the system temporary directory, made on the first
+    // eviction of a modified chunk and removed with the cache.
+    ChunkCache(size_t maxBytes = 32 * 1024 * 1024);
+    ~ChunkCache();
+    ChunkCache(const ChunkCache &) = delete;
+    ChunkCache &operator=(const ChunkCache &) = delete;
+
+    // Adds a chunk as the most recently used one and evicts the least recently used ones over budget.
+    void put(const std::pair<int, int> &key, ChunkBlocks blocks, bool modified = false);
+    // Moves a cached chunk out of the cache, from memory or from its file, and tells whether it was
+    // modified. False when it is in neither.
+    bool take(const std::pair<int, int> &key, ChunkBlocks &blocks, bool &modified);
+
+    size_t count() const { return m_index.size(); } // in memory
+    size_t getModifiedCount() const { return m_modifiedCount; } // in memory
+    size_t getSpilledCount() const { return m_spilled.size(); } // modified chunks in files
+    size_t getBytes() const { return m_bytes; }
+    size_t evicted = 0; // unmodified chunks dropped since the start
+
+    size_t maxBytes;
+
+private:
+    struct Entry {
+        std::pair<int, int> key;
+        ChunkBlocks blocks;
+        size_t bytes;
+        bool modified;
+    };
+    // Writes a modified chunk to its file, false when the directory or file cannot be written.
+    bool spill(const Entry &entry);
+    std::filesystem::path getPath(const std::pair<int, int> &key) const;
+
+    std::list<Entry> m_entries; // most recently used at the front
+    std::map<std::pair<int, int>, std::list<Entry>::iterator> m_index;
+    std::set<std::pair<int, int>> m_spilled;
+    std::filesystem::path m_directory; // empty until the first spill
+    size_t m_bytes = 0;
+    size_t m_modifiedCount = 0;
+};
+
+#endif // CHUNKCACHE_H
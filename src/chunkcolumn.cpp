@@ -0,0 +1,99 @@
+#include "chunkcolumn.h"
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <mutex>
+
+ChunkColumn::ChunkColumn(int height)
+    : m_height((height + sectionHeight - 1) / sectionHeight * sectionHeight)
+{
+}
+
+void ChunkColumn::set(int x, int y, int z, int id) {
+    if (z < 0 || z >= m_height || get(x, y, z) == id) {
+        return;
+    }
+    // Anything above the top section is air, so the air sections up to the block are added first
+    if (z / sectionHeight >= (int) m_sections.size()) {
+        m_sections.resize(z / sectionHeight + 1, getUniformSection(-1));
+    }
+    std::shared_ptr<ChunkSection> &section = m_sections[z / sectionHeight];
+    // Shared with the uniform table or another column, copy it before writing
+    if (section.use_count() > 1) {
+        section = std::allocate_shared<ChunkSection>(SlabAllocator<ChunkSection>(), *section);
+    }
+    section->set(x, y, z % sectionHeight, id);
+}
+
+void ChunkColumn::shareUniformSections() {
+    for (auto &section : m_sections) {
+        int id;
+        if (!section->isUniform() && section->getUniformID(id)) {
+            section = getUniformSection(id);
+        }
+    }
+    while (!m_sections.empty() && isEmpty(*m_sections.back())) {
+        m_sections.pop_back();
+    }
+    m_sections.shrink_to_fit();
+}
+
+int ChunkColumn::getAllocationCount() const {
+    int count = m_sections.capacity() > 0;
+    for (const auto &section : m_sections) {
+        if (!section->isUniform()) {
+            count += 1 + section->getAllocationCount(); // the section shares a block with its reference count
+        }
+    }
+    return count;
+}
+
+size_t ChunkColumn::getBytes() const {
+    size_t bytes = sizeof(ChunkColumn) + SlabPool::getBlockSize(m_sections.capacity() * sizeof(std::shared_ptr<ChunkSection>));
+    for (const auto &section : m_sections) {
+        if (!section->isUniform()) {
+            bytes += section->getBytes();
+        }
+    }
+    return bytes;
+}
+
+void ChunkColumn::write(std::ostream &out) const {
+    const int32_t header[2] = {m_height, static_cast<int32_t>(m_sections.size())};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const auto &section : m_sections) {
+        section->write(out);
+    }
+}
+
+bool ChunkColumn::read(std::istream &in) {
+    int32_t header[2];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] < 0 || header[0] % sectionHeight != 0 ||
+        header[1] < 0 || header[1] > header[0] / sectionHeight) {
+        return false;
+    }
+    m_height = header[0];
+    m_sections.clear();
+    m_sections.reserve(header[1]);
+    for (int i = 0; i < header[1]; i++) {
+        auto section = std::allocate_shared<ChunkSection>(SlabAllocator<ChunkSection>(), sectionWidth, sectionHeight);
+        if (!section->read(in)) {
+            return false;
+        }
+        m_sections.push_back(section->isUniform() ? getUniformSection(section->get(0, 0, 0)) : std::move(section));
+    }
+    return true;
+}
+
+std::shared_ptr<ChunkSection> ChunkColumn::getUniformSection(int id) {
+    // Columns are built on the job system's workers, so the table is shared between threads
+    static std::mutex mutex;
+    static std::map<int, std::shared_ptr<ChunkSection>> sections;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<ChunkSection> &section = sections[id];
+    if (!section) {
+        section = std::make_shared<ChunkSection>(sectionWidth, sectionHeight, id);
+    }
+    return section;
+}
@@ -0,0 +1,87 @@
+#ifndef CHUNKCOLUMN_H
+#define CHUNKCOLUMN_H
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <vector>
+#include "chunksection.h"
+
+// The blocks of one chunk as a stack of cubic sections. Only the sections up to the highest block
+// exist, so the height of the world costs nothing until something is built up there. Sections that
+// are a single block type, like air between the terrain and a tree or solid stone below it, all
+// point to one shared instance per id and take no memory of their own. A shared section is copied
+// the first time one of its blocks is changed, and shareUniformSections hands sections that became
+// uniform back. Sections and their storage come from the SlabPool, so unloading a column returns
+// its memory for the next one to reuse.
+class ChunkColumn
+{
+public:
+    static constexpr int sectionWidth = 8;
+    static constexpr int sectionHeight = 8;
+
+    // Starts out as all air with no sections, the height is rounded up to whole sections.
+    ChunkColumn(int height = 0);
+
+    // -1 for air and for positions outside the column.
+    int get(int x, int y, int z) const {
+        if (z < 0 || z >= (int) m_sections.size() * sectionHeight) {
+            return -1;
+        }
+        return m_sections[z / sectionHeight]->get(x, y, z % sectionHeight);
+    }
+    // Positions outside the column are ignored.
+    void set(int x, int y, int z, int id);
+    // Read from the solid bits of the section, false outside the column.
+    bool isSolid(int x, int y, int z) const {
+        if (z < 0 || z >= (int) m_sections.size() * sectionHeight) {
+            return false;
+        }
+        return m_sections[z / sectionHeight]->isSolid(x, y, z % sectionHeight);
+    }
+
+    // Calls visit(x, y, z, id) for every non-air block in section, then x, y, z order. Air sections are skipped.
+    template<typename Visitor>
+    void forEachBlock(Visitor &&visit) const;
+
+    // Swaps every section whose blocks are all the same for the shared one and drops the air sections
+    // on top, done once a column is built.
+    void shareUniformSections();
+
+    int getWidth() const { return sectionWidth; }
+    int getHeight() const { return m_height; }
+    int getSectionCount() const { return m_sections.size(); } // sections that exist, not the height
+    static bool isEmpty(const ChunkSection &section) { return section.isUniform() && section.get(0, 0, 0) == -1; }
+    const ChunkSection &getSection(int index) const { return *m_sections[index]; }
+    // Blocks taken from the SlabPool for this column, shared sections are not counted.
+    int getAllocationCount() const;
+    // Shared sections only count the pointer to them.
+    size_t getBytes() const;
+
+    // Writes the height and every section, read back by the same build on the same machine.
+    void write(std::ostream &out) const;
+    // Replaces the column with one written by write, uniform sections become the shared ones again.
+    // False when the data is cut short or malformed.
+    bool read(std::istream &in);
+
+private:
+    // The one immutable section made entirely of id.
+    static std::shared_ptr<ChunkSection> getUniformSection(int id);
+
+    int m_height;
+    std::vector<std::shared_ptr<ChunkSection>, SlabAllocator<std::shared_ptr<ChunkSection>>> m_sections; // bottom up to the highest block, written only when not shared
+};
+
+template<typename Visitor>
+void ChunkColumn::forEachBlock(Visitor &&visit) const {
+    for (size_t section = 0; section < m_sections.size(); section++) {
+        if (isEmpty(*m_sections[section])) {
+            continue;
+        }
+        int bottom = section * sectionHeight;
+        m_sections[section]->forEachBlock([&](int x, int y, int z, int id) {
+            visit(x, y, bottom + z, id);
+        });
+    }
+}
+
+#endif // CHUNKCOLUMN_H
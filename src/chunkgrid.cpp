@@ -0,0 +1,40 @@
+#include "chunkgrid.h"
+#include <cassert>
+
+ChunkGrid::ChunkGrid()
+    : m_slots(width * width)
+{
+}
+
+ChunkBlocks *ChunkGrid::find(const std::pair<int, int> &key) {
+    Chunk &chunk = m_slots[getSlot(key)];
+    return (chunk.loaded && chunk.key == key) ? &chunk.blocks : nullptr;
+}
+
+const ChunkBlocks *ChunkGrid::find(const std::pair<int, int> &key) const {
+    const Chunk &chunk = m_slots[getSlot(key)];
+    return (chunk.loaded && chunk.key == key) ? &chunk.blocks : nullptr;
+}
+
+void ChunkGrid::insert(const std::pair<int, int> &key, ChunkBlocks blocks) {
+    Chunk &chunk = m_slots[getSlot(key)];
+    assert(!chunk.loaded || chunk.key == key);
+    if (!chunk.loaded) {
+        m_count++;
+    }
+    chunk.key = key;
+    chunk.blocks = std::move(blocks);
+    chunk.loaded = true;
+}
+
+ChunkBlocks ChunkGrid::take(const std::pair<int, int> &key) {
+    Chunk &chunk = m_slots[getSlot(key)];
+    if (!chunk.loaded || chunk.key != key) {
+        return {};
+    }
+    chunk.loaded = false;
+    m_count--;
+    ChunkBlocks blocks = std::move(chunk.blocks);
+    chunk.blocks = ChunkBlocks();
+    return blocks;
+}
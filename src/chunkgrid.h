@@ -0,0 +1,65 @@
+#ifndef CHUNKGRID_H
+#define CHUNKGRID_H
+#include <utility>
+#include <vector>
+#include "chunkcolumn.h"
+
+// Blocks of one chunk by their local x, y and z index.
+using ChunkBlocks = ChunkColumn;
+
+// The loaded chunks around the player in a fixed size 2D ring buffer. Chunk (x, y) always lives in
+// slot (x mod width, y mod width), so a lookup is a single index and moving the window only touches
+// the chunks that enter or leave it.
+class ChunkGrid
+{
+public:
+    static const int width = 32; // power of two, wider than any window of loaded chunks
+
+    struct Chunk {
+        std::pair<int, int> key;
+        ChunkBlocks blocks;
+        bool loaded = false;
+    };
+
+    ChunkGrid();
+
+    // nullptr when the chunk is not loaded.
+    ChunkBlocks *find(const std::pair<int, int> &key);
+    const ChunkBlocks *find(const std::pair<int, int> &key) const;
+    bool contains(const std::pair<int, int> &key) const { return find(key) != nullptr; }
+
+    // The slot has to be free, callers unload the chunk leaving the window before loading the one replacing it.
+    void insert(const std::pair<int, int> &key, ChunkBlocks blocks);
+    // Unloads the chunk and hands back its blocks.
+    ChunkBlocks take(const std::pair<int, int> &key);
+
+    size_t count() const { return m_count; }
+
+    // Visits the loaded chunks in slot order.
+    class Iterator {
+    public:
+        Iterator(const std::vector<Chunk> &chunks, size_t index) : m_slots(chunks), m_index(index) { skipEmpty(); }
+        const Chunk &operator*() const { return m_slots[m_index]; }
+        const Chunk *operator->() const { return &m_slots[m_index]; }
+        Iterator &operator++() { m_index++; skipEmpty(); return *this; }
+        bool operator!=(const Iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        void skipEmpty() { while (m_index < m_slots.size() && !m_slots[m_index].loaded) m_index++; }
+        const std::vector<Chunk> &m_slots;
+        size_t m_index;
+    };
+    Iterator begin() const { return Iterator(m_slots, 0); }
+    Iterator end() const { return Iterator(m_slots, m_slots.size()); }
+
+private:
+    static int getSlot(const std::pair<int, int> &key) {
+        // masking wraps negative chunk indices the same way as positive ones
+        return (key.first & (width - 1)) * width + (key.second & (width - 1));
+    }
+
+    std::vector<Chunk> m_slots;
+    size_t m_count = 0;
+};
+
+#endif // CHUNKGRID_H
@@ -0,0 +1,210 @@
+#include "chunkmesher.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+const float tileSize = 1.0f / 16.0f;
+
+// The six faces of a block, using the same corners as Cube::setVertexData.
+struct Face {
+    glm::ivec3 normal;
+    glm::vec3 topLeft;
+    glm::vec3 topRight;
+    glm::vec3 bottomLeft;
+    glm::vec3 bottomRight;
+};
+
+const Face faces[6] = {
+    {{ 0,  0,  1}, {-0.5f,  0.5f,  0.5f}, { 0.5f,  0.5f,  0.5f}, {-0.5f, -0.5f,  0.5f}, { 0.5f, -0.5f,  0.5f}},
+    {{ 0,  0, -1}, { 0.5f,  0.5f, -0.5f}, {-0.5f,  0.5f, -0.5f}, { 0.5f, -0.5f, -0.5f}, {-0.5f, -0.5f, -0.5f}},
+    {{ 0,  1,  0}, {-0.5f,  0.5f, -0.5f}, { 0.5f,  0.5f, -0.5f}, {-0.5f,  0.5f,  0.5f}, { 0.5f,  0.5f,  0.5f}},
+    {{ 1,  0,  0}, { 0.5f,  0.5f,  0.5f}, { 0.5f,  0.5f, -0.5f}, { 0.5f, -0.5f,  0.5f}, { 0.5f, -0.5f, -0.5f}},
+    {{ 0, -1,  0}, {-0.5f, -0.5f,  0.5f}, { 0.5f, -0.5f,  0.5f}, {-0.5f, -0.5f, -0.5f}, { 0.5f, -0.5f, -0.5f}},
+    {{-1,  0,  0}, {-0.5f,  0.5f, -0.5f}, {-0.5f,  0.5f,  0.5f}, {-0.5f, -0.5f, -0.5f}, {-0.5f, -0.5f,  0.5f}},
+};
+
+// Section blocks plus a one block border from the neighbouring sections, so every lookup is an array index.
+// With the size known at compile time it lives on the stack and the index math folds into constants.
+template<int Size, int Height>
+struct PaddedVolume {
+    PaddedVolume(int, int) { ids.fill(-1); }
+    std::array<int, (Size + 2) * (Size + 2) * (Height + 2)> ids;
+
+    int &at(int x, int y, int z) {
+        return ids[((x + 1) * (Size + 2) + (y + 1)) * (Height + 2) + (z + 1)];
+    }
+};
+
+template<>
+struct PaddedVolume<0, 0> {
+    PaddedVolume(int size, int height) : size(size), height(height), ids((size + 2) * (size + 2) * (height + 2), -1) {}
+    int size;
+    int height;
+    std::vector<int> ids;
+
+    int &at(int x, int y, int z) {
+        return ids[((x + 1) * (size + 2) + (y + 1)) * (height + 2) + (z + 1)];
+    }
+};
+
+}
+
+ChunkMesher::ChunkMesher(const TerrainGenerator &generator)
+    : m_generator(generator)
+{
+}
+
+int ChunkMesher::getTile(int id, float z, bool top) {
+    if (z < -26) {
+        return (id == 0) ? cobblestone : stone;
+    }
+    if (z < (top ? -22 : -23)) {
+        return (id == waterID) ? water : sand;
+    }
+    if (id == 2) {
+        return logSide;
+    }
+    if (id == 3) {
+        return leaves;
+    }
+    return top ? grassTop : dirt;
+}
+
+bool ChunkMesher::isOpaque(int id) {
+    return isSolidID(id);
+}
+
+ChunkMesh ChunkMesher::buildMesh(int chunkX, int chunkY) const {
+    ChunkMesh mesh;
+    const ChunkBlocks *chunk = m_generator.getChunkMatrices().find({chunkX, chunkY});
+    if (chunk == nullptr) {
+        return mesh;
+    }
+    for (int section = 0; section < chunk->getSectionCount(); section++) {
+        SectionMesh sectionMesh = buildSectionMesh(chunkX, chunkY, section);
+        if (!sectionMesh.opaqueVertices.empty() || !sectionMesh.waterVertices.empty()) {
+            mesh.sections.push_back(std::move(sectionMesh));
+        }
+    }
+    return mesh;
+}
+
+SectionMesh ChunkMesher::buildSectionMesh(int chunkX, int chunkY, int sectionIndex) const {
+    const ChunkBlocks *chunk = m_generator.getChunkMatrices().find({chunkX, chunkY});
+    if (chunk == nullptr || sectionIndex >= chunk->getSectionCount() || ChunkColumn::isEmpty(chunk->getSection(sectionIndex))) {
+        SectionMesh mesh;
+        mesh.section = sectionIndex;
+        return mesh;
+    }
+    return buildSectionMesh(chunkX, chunkY, sectionIndex, chunk->getSection(sectionIndex));
+}
+
+template<typename Section>
+SectionMesh ChunkMesher::buildSectionMesh(int chunkX, int chunkY, int sectionIndex, const Section &section) const {
+    SectionMesh mesh;
+    mesh.section = sectionIndex;
+    const ChunkBlocks *chunk = m_generator.getChunkMatrices().find({chunkX, chunkY});
+
+    // Constants unless the section is sized at runtime
+    const int size = section.getWidth();
+    const int height = section.getHeight();
+    const int bottom = sectionIndex * height;
+
+    // Copy the section into the padded volume, with the border from the sections above and below and
+    // the neighbouring chunks. Below the world counts as solid so the bottom is never meshed.
+    PaddedVolume<Section::staticWidth, Section::staticHeight> volume(size, height);
+    for (int x = -1; x <= size; x++) {
+        for (int y = -1; y <= size; y++) {
+            bool side = x < 0 || y < 0 || x == size || y == size;
+            for (int z = -1; z <= height; z += side ? 1 : height + 1) {
+                if (bottom + z < 0) {
+                    volume.at(x, y, z) = 1;
+                } else if (side) {
+                    volume.at(x, y, z) = m_generator.getBlockID(chunkX * size + x, chunkY * size + y, bottom + z);
+                } else {
+                    volume.at(x, y, z) = chunk ? chunk->get(x, y, bottom + z) : -1;
+                }
+            }
+        }
+    }
+    section.forEachBlock([&](int x, int y, int z, int id) {
+        volume.at(x, y, z) = id;
+    });
+
+    auto addBlockFaces = [&](int x, int y, int z, int id) {
+        bool isWater = id == waterID;
+        glm::vec3 center = TerrainGenerator::getBlockCenter(chunkX * size + x, chunkY * size + y, bottom + z);
+        std::vector<float> &vertices = isWater ? mesh.waterVertices : mesh.opaqueVertices;
+
+        for (const Face &face : faces) {
+            glm::ivec3 n = face.normal;
+            int neighbour = volume.at(x + n.x, y + n.y, z + n.z);
+            // Water only shows against air, everything else shows against anything see-through.
+            if (isWater ? neighbour != -1 : isOpaque(neighbour)) {
+                continue;
+            }
+
+            int tile = getTile(id, center.z + 0.5f, n.z == 1); // + 0.5 matches Cube::getPosition
+            glm::vec2 tileOffset = glm::vec2(tile % 16, 15 - tile / 16) * tileSize;
+
+            glm::vec3 corners[4] = {face.topLeft, face.topRight, face.bottomLeft, face.bottomRight};
+            glm::vec2 uvs[4] = {tileOffset, tileOffset + glm::vec2(tileSize, 0),
+                                tileOffset + glm::vec2(0, tileSize), tileOffset + glm::vec2(tileSize, tileSize)};
+            float occlusion[4] = {3, 3, 3, 3};
+
+            if (ambientOcclusion) {
+                for (int i = 0; i < 4; i++) {
+                    // Step into the layer in front of the face, then towards the corner along both face axes.
+                    glm::ivec3 front = glm::ivec3(x, y, z) + n;
+                    glm::ivec3 side1(0), side2(0);
+                    bool first = true;
+                    for (int axis = 0; axis < 3; axis++) {
+                        if (n[axis] != 0) continue;
+                        (first ? side1 : side2)[axis] = (corners[i][axis] > 0) ? 1 : -1;
+                        first = false;
+                    }
+                    glm::ivec3 a = front + side1, b = front + side2, c = front + side1 + side2;
+                    int s1 = isOpaque(volume.at(a.x, a.y, a.z));
+                    int s2 = isOpaque(volume.at(b.x, b.y, b.z));
+                    int corner = isOpaque(volume.at(c.x, c.y, c.z));
+                    occlusion[i] = (s1 && s2) ? 0 : 3 - (s1 + s2 + corner);
+                }
+            }
+
+            // Split along the brighter diagonal so occlusion interpolates the same way on every face.
+            bool flip = occlusion[0] + occlusion[3] > occlusion[1] + occlusion[2];
+            const int defaultOrder[6] = {1, 0, 2, 1, 2, 3};
+            const int flippedOrder[6] = {0, 2, 3, 0, 3, 1};
+            const int *order = flip ? flippedOrder : defaultOrder;
+            for (int k = 0; k < 6; k++) {
+                int i = order[k];
+                glm::vec3 position = center + corners[i];
+                vertices.insert(vertices.end(), {position.x, position.y, position.z,
+                                                 (float) n.x, (float) n.y, (float) n.z,
+                                                 uvs[i].x, uvs[i].y, occlusion[i]});
+            }
+        }
+    };
+
+    int id = section.get(0, 0, 0);
+    if (section.isUniform() && isOpaque(id)) {
+        // Every block inside a solid section is covered, only its outer layer can show a face.
+        for (int x = 0; x < size; x++) {
+            for (int y = 0; y < size; y++) {
+                bool side = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+                // Inner columns only have a bottom and top block, which are the same one in a single layer section
+                for (int z = 0; z < height; z += side ? 1 : std::max(height - 1, 1)) {
+                    addBlockFaces(x, y, z, id);
+                }
+            }
+        }
+    } else {
+        section.forEachBlock(addBlockFaces);
+    }
+    return mesh;
+}
+
+template SectionMesh ChunkMesher::buildSectionMesh(int, int, int, const ChunkSection &) const;
+template SectionMesh ChunkMesher::buildSectionMesh(int, int, int, const DynamicChunkSection &) const;
+template SectionMesh ChunkMesher::buildSectionMesh(int, int, int, const MortonChunkSection &) const;
@@ -0,0 +1,60 @@
+#ifndef CHUNKMESHER_H
+#define CHUNKMESHER_H
+#include <vector>
+#include <glm/glm.hpp>
+#include "terraingenerator.h"
+
+// Vertex data for one section of a chunk. Each vertex is position (3), normal (3), uv (2) and ambient occlusion (1).
+struct SectionMesh {
+    int section = 0; // index in the chunk's column, bottom up
+    std::vector<float> opaqueVertices;
+    std::vector<float> waterVertices; // drawn after every opaque mesh so it blends over the terrain
+};
+
+// The sections of a chunk that have any faces, bottom up. Each is culled on its own.
+struct ChunkMesh {
+    std::vector<SectionMesh> sections;
+};
+
+class ChunkMesher
+{
+public:
+    ChunkMesher(const TerrainGenerator &generator);
+
+    // Builds the visible faces of a loaded chunk, reading neighbouring chunks for culling and occlusion.
+    ChunkMesh buildMesh(int chunkX, int chunkY) const;
+    // The same for one section, reading the sections above and below it as well.
+    SectionMesh buildSectionMesh(int chunkX, int chunkY, int section) const;
+    // Meshes the given blocks in place of that section, built for the ChunkSection, DynamicChunkSection
+    // and MortonChunkSection storage.
+    template<typename Section>
+    SectionMesh buildSectionMesh(int chunkX, int chunkY, int sectionIndex, const Section &section) const;
+
+    static const int floatsPerVertex = 9;
+    bool ambientOcclusion = true; // bake the 0-3 corner occlusion into each vertex
+
+    enum blockType {
+        gravel = 0,
+        stone = 1,
+        dirt = 2,
+        grassSide = 3,
+        woodPlank = 4,
+        cobblestone = 16,
+        bedrock = 17,
+        sand = 18,
+        logSide = 20,
+        logCap = 21,
+        grassTop = 39,
+        leaves = 40,
+        water = 178
+    };
+
+private:
+    // Picks the texture map tile of a block based on its id, height and whether it is the top face.
+    static int getTile(int id, float z, bool top);
+    static bool isOpaque(int id);
+
+    const TerrainGenerator &m_generator;
+};
+
+#endif // CHUNKMESHER_H
@@ -0,0 +1,111 @@
+#include "chunksection.h"
+#include <cassert>
+#include <istream>
+#include <ostream>
+
+template<int Width, int Height, SectionLayout Layout>
+void BasicChunkSection<Width, Height, Layout>::set(int x, int y, int z, int id) {
+    if (x < 0 || y < 0 || z < 0 || x >= getWidth() || y >= getWidth() || z >= getHeight()) {
+        return;
+    }
+    assert(id >= -1 && id <= INT8_MAX);
+
+    // Sections hold a few block types, so a linear search beats any lookup structure
+    int paletteIndex = 0;
+    while (paletteIndex < (int) m_palette.size() && m_palette[paletteIndex] != id) {
+        paletteIndex++;
+    }
+    if (paletteIndex == (int) m_palette.size()) {
+        if (m_palette.size() == (size_t(1) << m_bitsPerBlock)) {
+            widen();
+        }
+        m_palette.push_back(static_cast<int8_t>(id));
+    } else if (isUniform()) {
+        return; // already that id
+    }
+    int index = getIndex(x, y, z);
+    setPaletteIndex(index, paletteIndex);
+    uint64_t bit = uint64_t(1) << (index & 63);
+    m_solid[index >> 6] = isSolidID(id) ? m_solid[index >> 6] | bit : m_solid[index >> 6] & ~bit;
+}
+
+template<int Width, int Height, SectionLayout Layout>
+bool BasicChunkSection<Width, Height, Layout>::getUniformID(int &id) const {
+    int blockCount = getBlockCount();
+    int paletteIndex = getPaletteIndex(0);
+    for (int index = 1; index < blockCount; index++) {
+        if (getPaletteIndex(index) != paletteIndex) {
+            return false;
+        }
+    }
+    id = m_palette[paletteIndex];
+    return true;
+}
+
+template<int Width, int Height, SectionLayout Layout>
+size_t BasicChunkSection<Width, Height, Layout>::getBytes() const {
+    return sizeof(BasicChunkSection) + SlabPool::getBlockSize(m_palette.capacity() * sizeof(int8_t)) +
+           SlabPool::getBlockSize(m_words.capacity() * sizeof(uint64_t)) + SlabPool::getBlockSize(m_solid.capacity() * sizeof(uint64_t));
+}
+
+template<int Width, int Height, SectionLayout Layout>
+void BasicChunkSection<Width, Height, Layout>::write(std::ostream &out) const {
+    const uint8_t header[2] = {static_cast<uint8_t>(m_bitsPerBlock), static_cast<uint8_t>(m_palette.size())};
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(m_palette.data()), m_palette.size() * sizeof(int8_t));
+    out.write(reinterpret_cast<const char *>(m_words.data()), m_words.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char *>(m_solid.data()), m_solid.size() * sizeof(uint64_t));
+}
+
+template<int Width, int Height, SectionLayout Layout>
+bool BasicChunkSection<Width, Height, Layout>::read(std::istream &in) {
+    uint8_t header[2];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        return false;
+    }
+    int bitsPerBlock = header[0];
+    size_t paletteSize = header[1];
+    if ((bitsPerBlock != 0 && bitsPerBlock != 1 && bitsPerBlock != 2 && bitsPerBlock != 4 && bitsPerBlock != 8) ||
+        paletteSize == 0 || paletteSize > (size_t(1) << bitsPerBlock)) {
+        return false;
+    }
+    int blockCount = getBlockCount();
+    m_bitsPerBlock = bitsPerBlock;
+    m_palette.resize(paletteSize);
+    m_words.assign(bitsPerBlock == 0 ? 0 : (blockCount * bitsPerBlock + 63) / 64, 0);
+    m_solid.assign(bitsPerBlock == 0 ? 0 : (blockCount + 63) / 64, 0);
+    in.read(reinterpret_cast<char *>(m_palette.data()), m_palette.size() * sizeof(int8_t));
+    in.read(reinterpret_cast<char *>(m_words.data()), m_words.size() * sizeof(uint64_t));
+    in.read(reinterpret_cast<char *>(m_solid.data()), m_solid.size() * sizeof(uint64_t));
+    return bool(in);
+}
+
+template<int Width, int Height, SectionLayout Layout>
+void BasicChunkSection<Width, Height, Layout>::setPaletteIndex(int index, int paletteIndex) {
+    int bit = index * m_bitsPerBlock;
+    uint64_t mask = ((uint64_t(1) << m_bitsPerBlock) - 1) << (bit & 63);
+    uint64_t &word = m_words[bit >> 6];
+    word = (word & ~mask) | (uint64_t(paletteIndex) << (bit & 63));
+}
+
+// doubles the bits per block and repacks every index, a uniform section gets its first bit and its solid bits. Eight bits cover every int8_t id, so it never goes further.
+template<int Width, int Height, SectionLayout Layout>
+void BasicChunkSection<Width, Height, Layout>::widen() {
+    assert(m_bitsPerBlock < 8);
+    int bitsPerBlock = isUniform() ? 1 : m_bitsPerBlock * 2;
+    int blockCount = getBlockCount();
+    if (isUniform()) {
+        m_solid.assign((blockCount + 63) / 64, isSolidID(m_palette[0]) ? ~uint64_t(0) : 0);
+    }
+    Words words((blockCount * bitsPerBlock + 63) / 64, 0);
+    for (int index = 0; index < blockCount; index++) {
+        int bit = index * bitsPerBlock;
+        words[bit >> 6] |= uint64_t(getPaletteIndex(index)) << (bit & 63);
+    }
+    m_bitsPerBlock = bitsPerBlock;
+    m_words = std::move(words);
+}
+
+template class BasicChunkSection<8, 8, SectionLayout::linear>;
+template class BasicChunkSection<>;
+template class BasicChunkSection<8, 8, SectionLayout::morton>;
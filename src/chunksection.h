@@ -0,0 +1,248 @@
+#ifndef CHUNKSECTION_H
+#define CHUNKSECTION_H
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+#include "slaballocator.h"
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+// Block ids are -1 for air and 5 for water, every other block is solid: it stops the player and
+// hides the faces behind it.
+constexpr int airID = -1;
+constexpr int waterID = 5;
+constexpr bool isSolidID(int id) { return id != airID && id != waterID; }
+
+// Order of the blocks in a section's storage. Linear keeps each column contiguous with z changing
+// fastest, Morton interleaves the bits of x, y and z so blocks close in all three directions are
+// close in memory.
+enum class SectionLayout { linear, morton };
+
+// Interleaves the bits of x, y and z as ...x1y1z1x0y0z0.
+constexpr uint32_t encodeMorton(uint32_t x, uint32_t y, uint32_t z) {
+    uint32_t index = 0;
+    for (int bit = 0; bit < 10; bit++) {
+        index |= ((z >> bit) & 1) << (3 * bit) | ((y >> bit) & 1) << (3 * bit + 1) | ((x >> bit) & 1) << (3 * bit + 2);
+    }
+    return index;
+}
+
+// Block ids of a box of blocks, stored as a small palette of the ids that occur plus one palette
+// index per block packed into 64 bit words. A section of a single block type has no indices at
+// all, they start at 1 bit on the first different block and widen to 2, 4 and 8 bits as new ids
+// are added, so a section using a handful of block types takes a few bits per block. Alongside the
+// indices a section keeps one bit per block telling whether it is solid, so collision and
+// visibility checks never go through the palette.
+//
+// Width and Height fix the size at compile time, so index math and loop bounds are constants and
+// power of two sizes come down to shifts and masks. Leaving them at 0 takes the size at runtime instead.
+// The Morton layout needs a fixed power of two cube.
+template<int Width = 0, int Height = 0, SectionLayout Layout = SectionLayout::linear>
+class BasicChunkSection
+{
+public:
+    static constexpr bool isDynamic = Width == 0 || Height == 0;
+    static_assert(Layout == SectionLayout::linear || (!isDynamic && Width == Height && (Width & (Width - 1)) == 0),
+                  "Morton sections are fixed power of two cubes");
+    static constexpr int staticWidth = Width;
+    static constexpr int staticHeight = Height;
+
+    // Starts out with every block set to id, air by default.
+    BasicChunkSection(int width = Width, int height = Height, int id = -1)
+        : m_width(width), m_height(height), m_palette{static_cast<int8_t>(id)} {}
+
+    // -1 for air and for positions outside the section.
+    int get(int x, int y, int z) const {
+        if (x < 0 || y < 0 || z < 0 || x >= getWidth() || y >= getWidth() || z >= getHeight()) {
+            return -1;
+        }
+        return m_palette[getPaletteIndex(getIndex(x, y, z))];
+    }
+    // Positions outside the section are ignored.
+    void set(int x, int y, int z, int id);
+    // False for positions outside the section.
+    bool isSolid(int x, int y, int z) const {
+        if (x < 0 || y < 0 || z < 0 || x >= getWidth() || y >= getWidth() || z >= getHeight()) {
+            return false;
+        }
+        if (isUniform()) {
+            return isSolidID(m_palette[0]);
+        }
+        int index = getIndex(x, y, z);
+        return (m_solid[index >> 6] >> (index & 63)) & 1;
+    }
+
+    // Calls visit(x, y, z, id) for every non-air block in storage order, decoding a word at a time
+    // and skipping words that are all air.
+    template<typename Visitor>
+    void forEachBlock(Visitor &&visit) const;
+
+    int getWidth() const {
+        if constexpr (isDynamic) return m_width; else return Width;
+    }
+    int getHeight() const {
+        if constexpr (isDynamic) return m_height; else return Height;
+    }
+    int getBlockCount() const { return getWidth() * getWidth() * getHeight(); }
+    int getBitsPerBlock() const { return m_bitsPerBlock; }
+    // Every block has the same id, without looking at them.
+    bool isUniform() const { return m_bitsPerBlock == 0; }
+    // Looks at every block, false when they differ.
+    bool getUniformID(int &id) const;
+    size_t getPaletteSize() const { return m_palette.size(); }
+    // Blocks taken from the SlabPool besides the section itself, and the bytes of both.
+    int getAllocationCount() const { return (m_palette.capacity() > 0) + (m_words.capacity() > 0) + (m_solid.capacity() > 0); }
+    size_t getBytes() const;
+
+    // Writes the bits per block, palette, indices and solid bits as they are in memory, so only the same
+    // build on the same machine reads them back.
+    void write(std::ostream &out) const;
+    // Replaces the blocks with ones written by write, false when the data is cut short or malformed.
+    bool read(std::istream &in);
+
+private:
+    // Linear: z is the fastest changing index so a column is a contiguous run of indices.
+    // Morton: BMI2 deposits the bits of each coordinate where they go, otherwise a table per coordinate does.
+    int getIndex(int x, int y, int z) const {
+        if constexpr (Layout == SectionLayout::morton) {
+#if defined(__BMI2__)
+            return _pdep_u32(x, 0x24924924u) | _pdep_u32(y, 0x92492492u) | _pdep_u32(z, 0x49249249u);
+#else
+            return mortonTable[x] << 2 | mortonTable[y] << 1 | mortonTable[z];
+#endif
+        } else {
+            return (x * getWidth() + y) * getHeight() + z;
+        }
+    }
+    // Inverse of getIndex for the Morton layout, x, y and z packed a byte each.
+    static uint32_t decodeMorton(int index) {
+#if defined(__BMI2__)
+        return _pext_u32(index, 0x24924924u) << 16 | _pext_u32(index, 0x92492492u) << 8 | _pext_u32(index, 0x49249249u);
+#else
+        return mortonDecodeTable[index];
+#endif
+    }
+    static constexpr std::array<uint32_t, Width> makeMortonTable() {
+        std::array<uint32_t, Width> table{};
+        for (int i = 0; i < Width; i++) {
+            table[i] = encodeMorton(0, 0, i);
+        }
+        return table;
+    }
+    static constexpr std::array<uint32_t, Width * Width * Height> makeMortonDecodeTable() {
+        std::array<uint32_t, Width * Width * Height> table{};
+        for (int x = 0; x < Width; x++) {
+            for (int y = 0; y < Width; y++) {
+                for (int z = 0; z < Height; z++) {
+                    table[encodeMorton(x, y, z)] = x << 16 | y << 8 | z;
+                }
+            }
+        }
+        return table;
+    }
+    static constexpr std::array<uint32_t, Width> mortonTable = makeMortonTable();
+    static constexpr std::array<uint32_t, Width * Width * Height> mortonDecodeTable = makeMortonDecodeTable();
+
+    int getPaletteIndex(int index) const {
+        if (m_bitsPerBlock == 0) {
+            return 0;
+        }
+        // Widths divide 64, so an index never straddles two words.
+        int bit = index * m_bitsPerBlock;
+        return (m_words[bit >> 6] >> (bit & 63)) & ((1u << m_bitsPerBlock) - 1);
+    }
+    void setPaletteIndex(int index, int paletteIndex);
+    void widen();
+
+    int m_width;  // only read when isDynamic
+    int m_height;
+    int m_bitsPerBlock = 0;
+    using Words = std::vector<uint64_t, SlabAllocator<uint64_t>>;
+
+    std::vector<int8_t, SlabAllocator<int8_t>> m_palette;
+    Words m_words; // empty while the section is uniform
+    Words m_solid; // a bit per block in storage order, empty while the section is uniform
+};
+
+// Sections of the loaded world, chunks are 8 blocks wide and stacked in 8 block tall sections.
+// The layout can be switched to SectionLayout::morton here, Benchmark::runSectionLayouts compares the two.
+using ChunkSection = BasicChunkSection<8, 8, SectionLayout::linear>;
+// The same storage with its size read at runtime, kept to measure what the fixed size buys.
+using DynamicChunkSection = BasicChunkSection<>;
+using MortonChunkSection = BasicChunkSection<8, 8, SectionLayout::morton>;
+
+extern template class BasicChunkSection<8, 8, SectionLayout::linear>;
+extern template class BasicChunkSection<>;
+extern template class BasicChunkSection<8, 8, SectionLayout::morton>;
+
+template<int Width, int Height, SectionLayout Layout>
+template<typename Visitor>
+void BasicChunkSection<Width, Height, Layout>::forEachBlock(Visitor &&visit) const {
+    const int width = getWidth();
+    const int height = getHeight();
+    if (isUniform()) {
+        if (m_palette[0] == -1) {
+            return;
+        }
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < width; y++) {
+                for (int z = 0; z < height; z++) {
+                    visit(x, y, z, static_cast<int>(m_palette[0]));
+                }
+            }
+        }
+        return;
+    }
+
+    const int blocksPerWord = 64 / m_bitsPerBlock;
+    const uint64_t mask = (uint64_t(1) << m_bitsPerBlock) - 1;
+    const bool zeroIsAir = m_palette[0] == -1;
+    const int blockCount = getBlockCount();
+
+    int x = 0, y = 0, z = 0;
+    for (size_t word = 0; word < m_words.size(); word++) {
+        int first = word * blocksPerWord;
+        int count = std::min(blocksPerWord, blockCount - first);
+        if (m_words[word] == 0 && zeroIsAir) {
+            if constexpr (Layout == SectionLayout::morton) {
+                continue;
+            }
+            // Skip the whole word, moving the position along by count blocks
+            int index = first + count;
+            z = index % height;
+            y = (index / height) % width;
+            x = index / (height * width);
+            continue;
+        }
+        uint64_t bits = m_words[word];
+        if constexpr (Layout == SectionLayout::morton) {
+            for (int i = 0; i < count; i++, bits >>= m_bitsPerBlock) {
+                int id = m_palette[bits & mask];
+                if (id != -1) {
+                    uint32_t position = decodeMorton(first + i);
+                    visit(int(position >> 16), int(position >> 8 & 0xff), int(position & 0xff), id);
+                }
+            }
+            continue;
+        }
+        for (int i = 0; i < count; i++, bits >>= m_bitsPerBlock) {
+            int id = m_palette[bits & mask];
+            if (id != -1) {
+                visit(x, y, z, id);
+            }
+            if (++z == height) {
+                z = 0;
+                if (++y == width) {
+                    y = 0;
+                    x++;
+                }
+            }
+        }
+    }
+}
+
+#endif // CHUNKSECTION_H
@@ -0,0 +1,186 @@
+#include "collision.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "terraingenerator.h"
+
+namespace {
+
+// Gap kept between a box and the block that stopped it, so it does not count as inside the block next time
+const float skin = 1e-3f;
+
+// Below the world counts as solid, as it does for the bottom faces in the mesher, so nothing falls out
+bool isBlocking(const WorldView &world, glm::ivec3 block) {
+    return block.z < 0 || world.isSolid(block) || !world.isLoaded(block);
+}
+
+// Moves the box along one axis as far as the blocks allow and returns the distance it got.
+// Works in block space, where block i covers [i, i + 1) on every axis.
+float sweepAxis(const WorldView &world, Box &box, int axis, float distance) {
+    if (distance == 0) {
+        return 0;
+    }
+    const glm::vec3 origin = TerrainGenerator::getBlockCenter(0, 0, 0) - 0.5f;
+    const glm::vec3 min = box.min - origin;
+    const glm::vec3 max = box.max - origin;
+    const int axis1 = (axis + 1) % 3;
+    const int axis2 = (axis + 2) % 3;
+
+    // Blocks the box overlaps across the direction of movement
+    const int low1 = std::floor(min[axis1]), high1 = std::ceil(max[axis1]) - 1;
+    const int low2 = std::floor(min[axis2]), high2 = std::ceil(max[axis2]) - 1;
+
+    // Layers of blocks ahead of the leading face, up to where it will be
+    const float front = distance > 0 ? max[axis] : min[axis];
+    const int step = distance > 0 ? 1 : -1;
+    const int first = distance > 0 ? std::ceil(front) : std::floor(front) - 1;
+    const int last = distance > 0 ? std::ceil(front + distance) - 1 : std::floor(front + distance);
+
+    for (int layer = first; layer * step <= last * step; layer += step) {
+        glm::ivec3 block;
+        block[axis] = layer;
+        for (block[axis1] = low1; block[axis1] <= high1; block[axis1]++) {
+            for (block[axis2] = low2; block[axis2] <= high2; block[axis2]++) {
+                if (isBlocking(world, block)) {
+                    // Stop just short of the block, or stay put if already touching it
+                    float face = distance > 0 ? layer - skin : layer + 1 + skin;
+                    distance = distance > 0 ? std::max(face - front, 0.f) : std::min(face - front, 0.f);
+                    box.min[axis] += distance;
+                    box.max[axis] += distance;
+                    return distance;
+                }
+            }
+        }
+    }
+    box.min[axis] += distance;
+    box.max[axis] += distance;
+    return distance;
+}
+
+}
+
+Sweep sweepBox(const WorldView &world, const Box &box, glm::vec3 displacement) {
+    Sweep sweep;
+    Box moved = box;
+    for (int axis : {2, 0, 1}) {
+        sweep.moved[axis] = sweepAxis(world, moved, axis, displacement[axis]);
+        sweep.blocked[axis] = sweep.moved[axis] != displacement[axis];
+    }
+    return sweep;
+}
+
+Sweep stepBox(const WorldView &world, const Box &box, glm::vec3 displacement, float stepHeight) {
+    Sweep flat = sweepBox(world, box, displacement);
+    if (!flat.blocked.x && !flat.blocked.y) {
+        return flat;
+    }
+
+    // Climb, move across at the raised height, then drop back onto whatever is underneath
+    Sweep stepped;
+    Box raised = box;
+    float climbed = sweepAxis(world, raised, 2, stepHeight);
+    for (int axis : {0, 1}) {
+        stepped.moved[axis] = sweepAxis(world, raised, axis, displacement[axis]);
+        stepped.blocked[axis] = stepped.moved[axis] != displacement[axis];
+    }
+    stepped.moved.z = climbed + sweepAxis(world, raised, 2, -climbed);
+
+    glm::vec2 flatDistance(flat.moved), steppedDistance(stepped.moved);
+    return glm::dot(steppedDistance, steppedDistance) > glm::dot(flatDistance, flatDistance) ? stepped : flat;
+}
+
+bool raycast(const WorldView &world, glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit &hit) {
+    const int sectionWidth = ChunkColumn::sectionWidth;
+    const int sectionHeight = ChunkColumn::sectionHeight;
+    static_assert(sectionWidth == 8 && sectionHeight == 8, "section coordinates are found with shifts");
+
+    // In block space, where block i covers [i, i + 1) on every axis
+    direction = glm::normalize(direction);
+    const glm::vec3 start = origin - (TerrainGenerator::getBlockCenter(0, 0, 0) - 0.5f);
+    glm::ivec3 block = glm::floor(start);
+
+    // Distance along the ray to the next block boundary on each axis, and between boundaries
+    glm::ivec3 step;
+    glm::vec3 next, delta;
+    for (int axis = 0; axis < 3; axis++) {
+        if (direction[axis] == 0) {
+            step[axis] = 0;
+            next[axis] = delta[axis] = std::numeric_limits<float>::infinity();
+            continue;
+        }
+        step[axis] = direction[axis] > 0 ? 1 : -1;
+        delta[axis] = std::abs(1 / direction[axis]);
+        float boundary = direction[axis] > 0 ? block[axis] + 1 : block[axis];
+        next[axis] = (boundary - start[axis]) / direction[axis];
+    }
+
+    float distance = 0;
+    int lastAxis = -1;
+    glm::ivec3 sectionKey = block >> 3;
+    const ChunkSection *section = world.findSection(block);
+    bool empty = section == nullptr || ChunkColumn::isEmpty(*section);
+    while (true) {
+        if (!empty && section->isSolid(block.x & (sectionWidth - 1), block.y & (sectionWidth - 1), block.z & (sectionHeight - 1))) {
+            hit.block = block;
+            hit.normal = glm::ivec3(0);
+            if (lastAxis >= 0) {
+                hit.normal[lastAxis] = -step[lastAxis];
+            }
+            hit.distance = distance;
+            hit.id = section->get(block.x & (sectionWidth - 1), block.y & (sectionWidth - 1), block.z & (sectionHeight - 1));
+            return true;
+        }
+
+        if (empty) {
+            // Jump straight to the block where the ray leaves the section, or the whole chunk when it is
+            // not loaded. Boundaries inside it are counted rather than crossed one at a time.
+            const bool unloaded = section == nullptr && !world.isLoaded(block);
+            glm::ivec3 inside;
+            float exit = std::numeric_limits<float>::infinity();
+            for (int axis = 0; axis < 3; axis++) {
+                inside[axis] = std::numeric_limits<int>::max();
+                if (step[axis] == 0 || (axis == 2 && unloaded)) {
+                    continue;
+                }
+                const int low = sectionKey[axis] << 3;
+                inside[axis] = step[axis] > 0 ? low + 7 - block[axis] : block[axis] - low;
+                const float boundary = next[axis] + inside[axis] * delta[axis];
+                if (boundary < exit) {
+                    exit = boundary;
+                    lastAxis = axis;
+                }
+            }
+            distance = exit;
+            if (distance > maxDistance) {
+                return false;
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                if (step[axis] == 0) {
+                    continue;
+                }
+                int crossed = inside[axis] + 1;
+                if (axis != lastAxis) {
+                    crossed = std::clamp(int(std::ceil((exit - next[axis]) / delta[axis])), 0, inside[axis]);
+                }
+                block[axis] += crossed * step[axis];
+                next[axis] += crossed * delta[axis];
+            }
+        } else {
+            // Step into the neighbour across the nearest boundary
+            lastAxis = next.x < next.y ? (next.x < next.z ? 0 : 2) : (next.y < next.z ? 1 : 2);
+            distance = next[lastAxis];
+            if (distance > maxDistance) {
+                return false;
+            }
+            block[lastAxis] += step[lastAxis];
+            next[lastAxis] += delta[lastAxis];
+        }
+
+        // Only look the section up again once the ray has left the last one
+        if ((block >> 3) != sectionKey) {
+            sectionKey = block >> 3;
+            section = world.findSection(block);
+            empty = section == nullptr || ChunkColumn::isEmpty(*section);
+        }
+    }
+}
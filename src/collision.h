@@ -0,0 +1,42 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+#include <glm/glm.hpp>
+#include "worldview.h"
+
+// Axis aligned box in world space.
+struct Box {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// How far a box got and the axes a block stopped it on.
+struct Sweep {
+    glm::vec3 moved = glm::vec3(0);
+    glm::bvec3 blocked = glm::bvec3(false);
+};
+
+// Moves the box by displacement through the loaded blocks, one axis at a time in z, x, y order so it
+// slides along whatever stops it. Each axis reads only the layers of blocks the box passes through,
+// nearest first, however far it moves, so fast boxes cannot skip a block. Solid blocks, unloaded
+// chunks and the bottom of the world stop it, and it ends a small gap short of them.
+Sweep sweepBox(const WorldView &world, const Box &box, glm::vec3 displacement);
+
+// sweepBox for a box standing on the ground and moving horizontally. When a block stops it, it also
+// tries climbing up to stepHeight first and settling back down, and keeps whichever got further.
+Sweep stepBox(const WorldView &world, const Box &box, glm::vec3 displacement, float stepHeight);
+
+// First solid block along a ray.
+struct RayHit {
+    glm::ivec3 block;  // world block coordinate
+    glm::ivec3 normal; // of the face the ray entered through, 0 when it starts inside the block
+    float distance;    // from the origin to where the ray enters the block
+    int id;
+};
+
+// Walks the blocks the ray passes through in order (Amanatides and Woo) until a solid one, reading the
+// solid bits of each section directly. Empty sections are crossed in a single step to where the ray
+// leaves them, and unloaded chunks to where it leaves the chunk. False when nothing solid is within
+// maxDistance.
+bool raycast(const WorldView &world, glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit &hit);
+
+#endif // COLLISION_H
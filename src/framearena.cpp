@@ -0,0 +1,82 @@
+#include "framearena.h"
+#include <bit>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#ifndef NDEBUG
+// Debug builds count every global heap allocation per thread, which is how FrameArena reports the
+// allocations a frame made outside of it.
+namespace {
+thread_local size_t threadHeapAllocations = 0;
+}
+
+void *operator new(std::size_t bytes) {
+    threadHeapAllocations++;
+    if (void *pointer = std::malloc(bytes ? bytes : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+#endif
+
+FrameArena::FrameArena(size_t capacity)
+    : m_buffer(static_cast<char *>(::operator new(capacity))), m_capacity(capacity)
+{
+    m_heapAllocationsAtReset = getThreadHeapAllocations();
+}
+
+FrameArena::~FrameArena() {
+    for (void *block : m_overflow) {
+        ::operator delete(block);
+    }
+    ::operator delete(m_buffer);
+}
+
+void *FrameArena::allocate(size_t bytes, size_t alignment) {
+    // the buffer and overflow blocks come from operator new, aligned for any fundamental type
+    assert(alignment <= alignof(std::max_align_t));
+    size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+    if (start + bytes <= m_capacity) {
+        m_used = start + bytes;
+        return m_buffer + start;
+    }
+    m_overflow.push_back(::operator new(bytes));
+    m_overflowBytes += bytes;
+    return m_overflow.back();
+}
+
+void FrameArena::reset() {
+    size_t heapAllocations = getThreadHeapAllocations();
+    m_heapAllocations = heapAllocations - m_heapAllocationsAtReset;
+
+    if (!m_overflow.empty()) {
+        for (void *block : m_overflow) {
+            ::operator delete(block);
+        }
+        m_overflow.clear();
+        ::operator delete(m_buffer);
+        m_capacity = std::bit_ceil(m_capacity + m_overflowBytes);
+        m_buffer = static_cast<char *>(::operator new(m_capacity));
+        m_overflowBytes = 0;
+    }
+    m_used = 0;
+    // growing the buffer is not counted against the next frame
+    m_heapAllocationsAtReset = getThreadHeapAllocations();
+}
+
+size_t FrameArena::getThreadHeapAllocations() {
+#ifndef NDEBUG
+    return threadHeapAllocations;
+#else
+    return 0;
+#endif
+}
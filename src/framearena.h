@@ -0,0 +1,72 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Scratch memory for containers that only live for one frame or simulation step. Allocating bumps
+// a pointer through one buffer and freeing does nothing, the owner calls reset at the end of the
+// frame to take everything back at once. A frame that needs more than the buffer gets the rest from
+// the heap and the buffer grows to fit at the next reset, so a steady frame never touches the heap.
+// Used by the one thread that resets it.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity = 64 * 1024);
+    ~FrameArena();
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *allocate(size_t bytes, size_t alignment);
+    // Everything allocated since the last reset is gone, containers using it must be dead by now.
+    void reset();
+
+    size_t getCapacity() const { return m_capacity; }
+    // Global heap allocations the thread made between the last two resets. Only counted in debug
+    // builds, always 0 otherwise.
+    size_t getHeapAllocations() const { return m_heapAllocations; }
+    // Global heap allocations the calling thread has made, 0 in release builds.
+    static size_t getThreadHeapAllocations();
+
+private:
+    char *m_buffer;
+    size_t m_capacity;
+    size_t m_used = 0;
+    std::vector<void *> m_overflow; // heap blocks of a frame that did not fit
+    size_t m_overflowBytes = 0;
+    size_t m_heapAllocationsAtReset = 0;
+    size_t m_heapAllocations = 0;
+};
+
+// Standard allocator over a FrameArena, or the heap when there is none.
+template<typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    FrameAllocator(FrameArena *arena = nullptr) : arena(arena) {}
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t count) {
+        if (arena == nullptr) {
+            return std::allocator<T>().allocate(count);
+        }
+        return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *pointer, size_t count) {
+        if (arena == nullptr) {
+            std::allocator<T>().deallocate(pointer, count);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U> &other) const { return arena == other.arena; }
+
+    FrameArena *arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif // FRAMEARENA_H
@@ -2,12 +2,12 @@
 
 #include <QCoreApplication>
 #include <QWindow>
+#include <cstdio>
 
 #include "shaderloader.h"
 #include "examplehelpers.h"
 #include "cube.h"
 #include "camera.h"
-#include "terraingenerator.h"
 
 GLRenderer::GLRenderer(QWidget *parent)
   : QOpenGLWidget(parent),
@@ -24,29 +24,25 @@ GLRenderer::GLRenderer(QWidget *parent)
     setMouseTracking(true);
     setFocusPolicy(Qt::StrongFocus);
 
-    m_keyMap[Qt::Key_W]       = false;
-    m_keyMap[Qt::Key_A]       = false;
-    m_keyMap[Qt::Key_S]       = false;
-    m_keyMap[Qt::Key_D]       = false;
-    m_keyMap[Qt::Key_Control] = false;
-    m_keyMap[Qt::Key_Space]   = false;
-
     m_proj = glm::perspective(glm::radians(45.0), 1.0 * this->width() / this->height(), 0.01,100.0);
 }
 
 void GLRenderer::finish()
 {
+  m_simulation.stop();
+
   glDeleteProgram(m_texture_shader);
   glDeleteProgram(m_phong_shader);
-  glDeleteVertexArrays(1, &m_cube_vao);
-  glDeleteBuffers(1, &m_cube_vbo);
+  for (auto &chunkMesh : m_chunkMeshes) {
+      glDeleteVertexArrays(1, &chunkMesh.second.vao);
+      glDeleteBuffers(1, &chunkMesh.second.vbo);
+  }
   glDeleteVertexArrays(1, &m_fullscreen_vao);
   glDeleteBuffers(1, &m_fullscreen_vbo);
+  glDeleteQueries(2, m_frameQueries);
 
   // Task 35: Delete OpenGL memory here
-  glDeleteTextures(1, &m_fbo_texture);
-  glDeleteRenderbuffers(1, &m_fbo_renderbuffer);
-  glDeleteFramebuffers(1, &m_fbo);
+  deleteFBO();
 
   doneCurrent();
 }
@@ -60,12 +56,8 @@ void GLRenderer::initializeGL()
 
   m_devicePixelRatio = this->devicePixelRatio();
 
-  m_defaultFBO = 2;
   m_screen_width = size().width() * m_devicePixelRatio;
   m_screen_height = size().height() * m_devicePixelRatio;
-  m_fbo_width = m_screen_width;
-  m_fbo_height = m_screen_height;
-  initTextureMap();
 
 
   // GLEW is a library which provides an implementation for the OpenGL API
@@ -82,21 +74,16 @@ void GLRenderer::initializeGL()
   glEnable(GL_BLEND); // For fade out
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   
+  // GPU timers for the resolution scaler, two so we never wait on the frame still in flight
+  glGenQueries(2, m_frameQueries);
+
   // Load shaders
   m_texture_shader = ShaderLoader::createShaderProgram(":/resources/shaders/texture.vert", ":/resources/shaders/texture.frag");
   m_phong_shader   = ShaderLoader::createShaderProgram(":/resources/shaders/phong.vert", ":/resources/shaders/phong.frag");
   
   // Prepare example geometry for rendering later
-  Cube* newCube = new Cube(glm::mat4(1.0f));
-  m_cube_data = newCube->initialize(1, 1, 0.0f/16.0f,0.0f/16.0f);
   initializeExampleGeometry();
 
-  lightTypes.push_back(1);
-  lightPositions.push_back(glm::vec4(10.0, 0.0, 0.0,1.0));
-  lightDirections.push_back(glm::vec4(0.0, 0.0, -1.0,1.0f));
-  attenuationFunctions.push_back(glm::vec3(0.0, 0.0, 0.0f));
-  lightColors.push_back(glm::vec3(1.0,1.0,1.0));
-
   // Task 9: Set the active texture slot to texture slot 0
   glActiveTexture(GL_TEXTURE0);
 
@@ -144,11 +131,12 @@ void GLRenderer::initializeGL()
   // Unbind the fullscreen quad's VBO and VAO
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
-
-  makeFBO();
 }
 
 void GLRenderer::makeFBO(){
+  m_fbo_width = std::max(1, static_cast<int>(m_screen_width * m_renderScale));
+  m_fbo_height = std::max(1, static_cast<int>(m_screen_height * m_renderScale));
+
     // Task 19: Generate and bind an empty texture, set its min/mag filter interpolation, then unbind
   glGenTextures(1, &m_fbo_texture);
   glBindTexture(GL_TEXTURE_2D, m_fbo_texture);
@@ -176,171 +164,167 @@ void GLRenderer::makeFBO(){
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void GLRenderer::deleteFBO(){
+    glDeleteTextures(1, &m_fbo_texture);
+    glDeleteRenderbuffers(1, &m_fbo_renderbuffer);
+    glDeleteFramebuffers(1, &m_fbo);
+    m_fbo = 0;
+}
+
 void GLRenderer::paintGL()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    m_frameTimer.start();
+    glBeginQuery(GL_TIME_ELAPSED, m_frameQueries[m_frameQueryIndex]);
+
+    // QOpenGLWidget is already an FBO that Qt composites, so the scene is drawn straight into it
+    // and only goes through our own FBO when there is a post effect to apply or it is rendered
+    // below native resolution.
+    m_defaultFBO = defaultFramebufferObject();
+    float scale = m_resolutionScaler.getScale();
+    bool useFBO = m_postProcessing || scale < 1.0f;
+    if (useFBO && (m_fbo == 0 || scale != m_renderScale)) {
+        if (m_fbo != 0) deleteFBO();
+        m_renderScale = scale;
+        makeFBO();
+    } else if (!useFBO && m_fbo != 0) {
+        deleteFBO();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, useFBO ? m_fbo : m_defaultFBO);
 
 
     // Task 28: Call glViewport
-    glViewport(0,0, m_screen_width, m_screen_height);
+    glViewport(0,0, useFBO ? m_fbo_width : m_screen_width, useFBO ? m_fbo_height : m_screen_height);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    for(const auto& shape : cubesVector){
-        glBindVertexArray(m_cube_vao);
-        glUseProgram(m_phong_shader);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_grass_texture);
-        glUniform1i(glGetUniformLocation(m_phong_shader, "myTexture"), 1);
-
-        // Set uniforms for Phong vertex shader
-        auto modelLoc = glGetUniformLocation(m_phong_shader, "modelMatrix");
-        auto viewLoc  = glGetUniformLocation(m_phong_shader, "viewMatrix");
-        auto projLoc  = glGetUniformLocation(m_phong_shader, "projMatrix");
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, &shape->getCTM()[0][0]);
-        glUniformMatrix4fv(viewLoc,  1, GL_FALSE, &m_view[0][0]);
-        glUniformMatrix4fv(projLoc,  1, GL_FALSE, &m_proj[0][0]);
-
-        // Set uniforms for Phong fragment shader
-//        glUniform4f(glGetUniformLocation(m_phong_shader, "light.position"), 10, 0, 0, 1);
-//        glUniform3f(glGetUniformLocation(m_phong_shader, "light.color"), 1, 1,1);
-//        glUniform4f(glGetUniformLocation(m_phong_shader, "light.direction"), 0, 0, -1.0,1.0f);
-
-        glUniform1i(glGetUniformLocation(m_phong_shader, "lightLength"),lightTypes.size());
-
-        for (size_t i = 0; i < lightTypes.size(); ++i) {
-            GLint loc = glGetUniformLocation(m_phong_shader, ("lightTypes[" + std::to_string(i) + "]").c_str());
-            glUniform1i(loc, lightTypes[i]);
 
-            GLint loc2 = glGetUniformLocation(m_phong_shader, ("lightDirections[" + std::to_string(i) + "]").c_str());
-            glUniform4f(loc2, lightDirections[i].x, lightDirections[i].y, lightDirections[i].z, lightDirections[i].w);
+    // Everything below reads the newest snapshot, the simulation thread keeps stepping meanwhile
+    const FrameSnapshot &snapshot = m_simulation.acquireSnapshot();
+    bool steady = !syncChunkMeshes(snapshot);
+    updateCamera(snapshot);
 
-            GLint loc3 = glGetUniformLocation(m_phong_shader, ("lightAttenuations[" + std::to_string(i) + "]").c_str());
-            glUniform3f(loc3, attenuationFunctions[i].x, attenuationFunctions[i].y, attenuationFunctions[i].z);
+    glUseProgram(m_phong_shader);
 
-            GLint loc4 = glGetUniformLocation(m_phong_shader, ("lightPositions[" + std::to_string(i) + "]").c_str());
-            glUniform4f(loc4, lightPositions[i].x, lightPositions[i].y, lightPositions[i].z, lightPositions[i].w);
-
-            GLint loc5 = glGetUniformLocation(m_phong_shader, ("lightColors[" + std::to_string(i) + "]").c_str());
-            glUniform3f(loc5, lightColors[i].x, lightColors[i].y, lightColors[i].z);
-        }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_grass_texture);
+    glUniform1i(glGetUniformLocation(m_phong_shader, "myTexture"), 1);
+
+    // Set uniforms for Phong vertex shader, chunk meshes are already in world space
+    glUniformMatrix4fv(glGetUniformLocation(m_phong_shader, "modelMatrix"), 1, GL_FALSE, &m_model[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_phong_shader, "viewMatrix"), 1, GL_FALSE, &m_view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(m_phong_shader, "projMatrix"), 1, GL_FALSE, &m_proj[0][0]);
+
+    const auto &lightTypes = snapshot.lightTypes;
+    const auto &lightDirections = snapshot.lightDirections;
+    const auto &attenuationFunctions = snapshot.attenuationFunctions;
+    const auto &lightPositions = snapshot.lightPositions;
+    const auto &lightColors = snapshot.lightColors;
+    glUniform1i(glGetUniformLocation(m_phong_shader, "lightLength"),lightTypes.size());
+
+    // Uniform names are formatted on the stack, std::string would allocate for most of them every frame
+    char name[64];
+    for (size_t i = 0; i < lightTypes.size(); ++i) {
+        std::snprintf(name, sizeof(name), "lightTypes[%zu]", i);
+        GLint loc = glGetUniformLocation(m_phong_shader, name);
+        glUniform1i(loc, lightTypes[i]);
+
+        std::snprintf(name, sizeof(name), "lightDirections[%zu]", i);
+        GLint loc2 = glGetUniformLocation(m_phong_shader, name);
+        glUniform4f(loc2, lightDirections[i].x, lightDirections[i].y, lightDirections[i].z, lightDirections[i].w);
+
+        std::snprintf(name, sizeof(name), "lightAttenuations[%zu]", i);
+        GLint loc3 = glGetUniformLocation(m_phong_shader, name);
+        glUniform3f(loc3, attenuationFunctions[i].x, attenuationFunctions[i].y, attenuationFunctions[i].z);
+
+        std::snprintf(name, sizeof(name), "lightPositions[%zu]", i);
+        GLint loc4 = glGetUniformLocation(m_phong_shader, name);
+        glUniform4f(loc4, lightPositions[i].x, lightPositions[i].y, lightPositions[i].z, lightPositions[i].w);
+
+        std::snprintf(name, sizeof(name), "lightColors[%zu]", i);
+        GLint loc5 = glGetUniformLocation(m_phong_shader, name);
+        glUniform3f(loc5, lightColors[i].x, lightColors[i].y, lightColors[i].z);
+    }
 
-        glUniform1f(glGetUniformLocation(m_phong_shader, "ka"),m_ka);
-        glUniform1f(glGetUniformLocation(m_phong_shader, "kd"),m_kd);
-        glUniform1f(glGetUniformLocation(m_phong_shader, "ks"),m_ks);
-        // deciding which texture based off of layers
-        glm::vec3 position = shape->getPosition();
-        bool isCovered = true;
-        for (int i = 0; i < 6; i++){
-            int a = (i % 3 == 0) ? ((i == 3) ? -1 : 1) : 0;
-            int b = (i % 3 == 1) ? ((i == 4) ? -1 : 1) : 0;
-            int c = (i % 3 == 2) ? 1 : 0;
-//            int c = (i % 3 == 2) ? ((i == 5) ? -1 : 1) : 0; (if we want to render blocks that are only exposed on the bottom)
-            std::tuple<float, float, float> nearbyBlock = {position[0] + a, position[1] + b, position[2] + c};
-            if (blockMap[nearbyBlock] == false){
-                isCovered = false;
+    glUniform1f(glGetUniformLocation(m_phong_shader, "ka"),m_ka);
+    glUniform1f(glGetUniformLocation(m_phong_shader, "kd"),m_kd);
+    glUniform1f(glGetUniformLocation(m_phong_shader, "ks"),m_ks);
+
+    // Fade terrain out just past the edge of the loaded chunks
+    float fadeDistance = (snapshot.renderDistance + 1) * TerrainGenerator::chunkSize + 1;
+    glUniform1f(glGetUniformLocation(m_phong_shader, "fadeDistance"), fadeDistance);
+
+    // Draw the opaque terrain of every section in view first, then the water so it blends over it
+    updateFrustumPlanes();
+    FrameVector<std::pair<GLuint, const SectionRange*>> visibleSections(&m_frameArena);
+    for (const auto &chunkMesh : m_chunkMeshes) {
+        for (const SectionRange &section : chunkMesh.second.sections) {
+            if (isSectionInFrustum(chunkMesh.first, section.section)) {
+                visibleSections.push_back({chunkMesh.second.vao, &section});
             }
         }
-        int currID = shape->getID();
-        if (isCovered && currID != 2 && currID != 3){
-            continue;
-        }
-        glUniform1i(glGetUniformLocation(m_phong_shader, "blockID"), currID);
-
-        blockMap[{position[0], position[1], position[2]}] = true;
-        float z_val = position[2];
-        if (z_val < -26){
-            if (currID == 0){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::cobblestone].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::cobblestone].y);
-            }
-            else if(currID == 1) {
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::stone].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::stone].y);
-            }
+    }
 
-        }
-        else if (z_val >= -26 && z_val < -22){
-            if (currID == 5){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::water].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::water].y);
-            }
-            else {
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::sand].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::sand].y);
-            }
-        }
-        else {
-            if(currID == 2){
+    glUniform1i(glGetUniformLocation(m_phong_shader, "blockID"), 0);
+    for (const auto &[vao, section] : visibleSections) {
+        if (section->opaqueCount == 0) continue;
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, section->opaqueFirst, section->opaqueCount);
+    }
 
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::logSide].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::logSide].y);
+    glUniform1i(glGetUniformLocation(m_phong_shader, "blockID"), 5);
+    for (const auto &[vao, section] : visibleSections) {
+        if (section->waterCount == 0) continue;
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, section->waterFirst, section->waterCount);
+    }
 
-            }else if(currID == 3){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::leaves].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::leaves].y);
-            }
-            else {
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::grassTop].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::grassTop].y);
+    // Unbind
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
 
-            }
-        }
+    if (useFBO) {
+        // Task 25: Bind the default framebuffer
+        glBindFramebuffer(GL_FRAMEBUFFER, m_defaultFBO);
+        glViewport(0,0, m_screen_width, m_screen_height);
 
+        // Task 26: Clear the color and depth buffers
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // Task 27: Call paintTexture to draw our FBO color attachment texture, upscaling it if needed
+        paintTexture(m_fbo_texture, m_postProcessing);
+    }
 
-        // Draw
-        glBindVertexArray(m_cube_vao);
-        glDrawArrays(GL_TRIANGLES, 0, 6); // draw top face
+    glEndQuery(GL_TIME_ELAPSED);
+    updateRenderScale();
 
-        if (z_val < -26){
-            if (shape->getID() == 0){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::cobblestone].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::cobblestone].y);
-            }
-            else {
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::stone].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::stone].y);
-            }
-        }
-        else if (z_val >= -26 && z_val < -23){
-            if (shape->getID() == 5){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::water].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::water].y);
-            }
-            else {
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::sand].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::sand].y);
-            }
-        }
-        else {
-            if(shape->getID() == 2){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::logSide].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::logSide].y);
-            }else if(shape->getID() ==3){
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::leaves].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::leaves].y);
-            }else{
-                glUniform1f(glGetUniformLocation(m_phong_shader, "xOffset"), textureMap[blockType::dirt].x);
-                glUniform1f(glGetUniformLocation(m_phong_shader, "yOffset"), textureMap[blockType::dirt].y);
-            }
+    // A frame that uploaded nothing should not have gone to the heap, debug builds check
+    m_frameArena.reset();
+    if (steady) {
+        m_steadyFrames++;
+        m_allocatingFrames += m_frameArena.getHeapAllocations() > 0;
+    }
+}
 
+// Feeds the cost of the frame to the resolution scaler. The GPU time comes from the previous frame's
+// query, which is normally ready by now, so reading it does not stall the pipeline.
+void GLRenderer::updateRenderScale(){
+    float frameTime = m_frameTimer.nsecsElapsed() / 1000000.f;
+
+    int previous = 1 - m_frameQueryIndex;
+    if (m_frameQueryIssued[previous]) {
+        GLint available = 0;
+        glGetQueryObjectiv(m_frameQueries[previous], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 gpuTime = 0;
+            glGetQueryObjectui64v(m_frameQueries[previous], GL_QUERY_RESULT, &gpuTime);
+            frameTime = std::max(frameTime, gpuTime / 1000000.f);
         }
-
-        glDrawArrays(GL_TRIANGLES, 6, (m_cube_data.size() / 8) - 6); // draw remaining faces
-        // Unbind
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glUseProgram(0);
     }
+    m_frameQueryIssued[m_frameQueryIndex] = true;
+    m_frameQueryIndex = previous;
 
-    // Task 25: Bind the default framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, m_defaultFBO);
-
-    // Task 26: Clear the color and depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Task 27: Call paintTexture to draw our FBO color attachment texture | Task 31: Set bool parameter to true
-    paintTexture(m_fbo_texture, true);
+    m_resolutionScaler.addFrameTime(frameTime);
+    m_lastFrameTime = frameTime;
+    m_simulation.lastFrameTime = frameTime;
 }
 
 // Task 31: Update the paintTexture function signature
@@ -349,6 +333,10 @@ void GLRenderer::paintTexture(GLuint texture, bool postProcessing){
     // Task 32: Set your bool uniform on whether or not to filter the texture drawn
     glUniform1i(glGetUniformLocation(m_texture_shader, "postProcessing"),postProcessing);
 
+    // Sharpen more the further the scene is scaled down, native resolution is a plain copy
+    glUniform1f(glGetUniformLocation(m_texture_shader, "sharpness"), 1.0f - m_renderScale);
+    glUniform2f(glGetUniformLocation(m_texture_shader, "texelSize"), 1.0f / m_fbo_width, 1.0f / m_fbo_height);
+
     glBindVertexArray(m_fullscreen_vao);
     // Task 10: Bind "texture" to slot 0
 
@@ -362,19 +350,14 @@ void GLRenderer::paintTexture(GLuint texture, bool postProcessing){
 }
 
 void GLRenderer::resizeGL(int w, int h){
-    // Task 34: Delete Texture, Renderbuffer, and Framebuffer memory
-
-    glDeleteTextures(1, &m_fbo_texture);
-    glDeleteRenderbuffers(1, &m_fbo_renderbuffer);
-    glDeleteFramebuffers(1, &m_fbo);
-
     m_screen_width = size().width() * m_devicePixelRatio;
     m_screen_height = size().height() * m_devicePixelRatio;
-    m_fbo_width = m_screen_width;
-    m_fbo_height = m_screen_height;
-    // Task 34: Regenerate your FBOs
 
-    makeFBO();
+    // Task 34: Delete and regenerate the FBO if it is in use
+    if (m_fbo != 0) {
+        deleteFBO();
+        makeFBO();
+    }
 
 
     m_proj = glm::perspective(glm::radians(45.0), 1.0 * w / h, 0.01, 100.0);
@@ -413,31 +396,96 @@ void GLRenderer::initializeExampleGeometry()
     // Task 7: Unbind kitten texture
     glBindTexture(GL_TEXTURE_2D, 0);
 
-  // Generate and bind the VBO
-  glGenBuffers(1, &m_cube_vbo);
-  glBindBuffer(GL_ARRAY_BUFFER, m_cube_vbo);
-
-  // Put data into the VBO
-
-  cubesVector = generator.updatePlayerPosition(cameraPos, std::vector<Cube*>(), true);
-  populateBlockMap();
+  // Load every chunk around the player up front, then keep streaming them on the simulation thread
+  m_simulation.start();
+}
 
-  // Translate the matrix by (1, 1, 1)
+// Uploads the meshes that are new or were rebuilt since the last frame and frees the ones of unloaded chunks.
+bool GLRenderer::syncChunkMeshes(const FrameSnapshot &snapshot) {
+  // The simulation replaces the map whenever a mesh changes, so an unchanged pointer means nothing to do
+  if (snapshot.chunkMeshes == m_syncedChunkMeshes) {
+      return false;
+  }
+  m_syncedChunkMeshes = snapshot.chunkMeshes;
+
+  // Both maps are sorted by chunk, so one pass over them finds the removed, added and rebuilt meshes
+  auto it = m_chunkMeshes.begin();
+  for (const auto &chunkMesh : *snapshot.chunkMeshes) {
+      while (it != m_chunkMeshes.end() && it->first < chunkMesh.first) {
+          glDeleteVertexArrays(1, &it->second.vao);
+          glDeleteBuffers(1, &it->second.vbo);
+          it = m_chunkMeshes.erase(it);
+      }
+      if (it != m_chunkMeshes.end() && it->first == chunkMesh.first) {
+          if (it->second.source != chunkMesh.second) {
+              uploadChunkMesh(chunkMesh.first, chunkMesh.second);
+          }
+          ++it;
+      } else {
+          uploadChunkMesh(chunkMesh.first, chunkMesh.second);
+      }
+  }
+  while (it != m_chunkMeshes.end()) {
+      glDeleteVertexArrays(1, &it->second.vao);
+      glDeleteBuffers(1, &it->second.vbo);
+      it = m_chunkMeshes.erase(it);
+  }
+  return true;
+}
 
-  glBufferData(GL_ARRAY_BUFFER, m_cube_data.size() * sizeof(GLfloat), m_cube_data.data(), GL_STATIC_DRAW);
+void GLRenderer::uploadChunkMesh(const std::pair<int, int> &key, const std::shared_ptr<const ChunkMesh> &source) {
+  auto it = m_chunkMeshes.find(key);
+  if (it == m_chunkMeshes.end()) {
+      ChunkMeshGL chunkMesh;
+      glGenBuffers(1, &chunkMesh.vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, chunkMesh.vbo);
+      glGenVertexArrays(1, &chunkMesh.vao);
+      glBindVertexArray(chunkMesh.vao);
+
+      GLsizei stride = ChunkMesher::floatsPerVertex * sizeof(GLfloat);
+      glEnableVertexAttribArray(0);
+      glEnableVertexAttribArray(1);
+      glEnableVertexAttribArray(2);
+      glEnableVertexAttribArray(3);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0)); // position
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(3 * sizeof(GLfloat))); // normal
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(6 * sizeof(GLfloat))); // texture uv coor
+      glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(8 * sizeof(GLfloat))); // ambient occlusion
+
+      it = m_chunkMeshes.insert({key, chunkMesh}).first;
+  }
 
-  // Generate and bind the VAO, with our VBO currently bound
-  glGenVertexArrays(1, &m_cube_vao);
-  glBindVertexArray(m_cube_vao);
+  ChunkMeshGL &chunkMesh = it->second;
+  const ChunkMesh &mesh = *source;
+  chunkMesh.source = source;
 
-  // Define VAO attributes
-  glEnableVertexAttribArray(0); // handles Vertex positions
-  glEnableVertexAttribArray(1); // handles Vertex normals
-  glEnableVertexAttribArray(2); // handles Vertex normals
+  // Lay out the opaque vertices of all sections, then the water ones
+  GLint opaqueVertexCount = 0;
+  GLint vertexCount = 0;
+  for (const SectionMesh &section : mesh.sections) {
+      opaqueVertexCount += section.opaqueVertices.size() / ChunkMesher::floatsPerVertex;
+      vertexCount += (section.opaqueVertices.size() + section.waterVertices.size()) / ChunkMesher::floatsPerVertex;
+  }
+  chunkMesh.sections.clear();
+  GLint opaqueFirst = 0;
+  GLint waterFirst = opaqueVertexCount;
+  for (const SectionMesh &section : mesh.sections) {
+      GLsizei opaqueCount = section.opaqueVertices.size() / ChunkMesher::floatsPerVertex;
+      GLsizei waterCount = section.waterVertices.size() / ChunkMesher::floatsPerVertex;
+      chunkMesh.sections.push_back({section.section, opaqueFirst, opaqueCount, waterFirst, waterCount});
+      opaqueFirst += opaqueCount;
+      waterFirst += waterCount;
+  }
 
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void*>(0)); // position
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat))); // normal
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat))); // texture uv coor
+  GLsizeiptr vertexBytes = ChunkMesher::floatsPerVertex * sizeof(GLfloat);
+  glBindBuffer(GL_ARRAY_BUFFER, chunkMesh.vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * vertexBytes, nullptr, GL_STATIC_DRAW);
+  for (size_t i = 0; i < mesh.sections.size(); i++) {
+      const SectionMesh &section = mesh.sections[i];
+      const SectionRange &range = chunkMesh.sections[i];
+      glBufferSubData(GL_ARRAY_BUFFER, range.opaqueFirst * vertexBytes, range.opaqueCount * vertexBytes, section.opaqueVertices.data());
+      glBufferSubData(GL_ARRAY_BUFFER, range.waterFirst * vertexBytes, range.waterCount * vertexBytes, section.waterVertices.data());
+  }
 
   // Unbind
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -445,10 +493,40 @@ void GLRenderer::initializeExampleGeometry()
 }
 
 
+// Gribb and Hartmann: each plane is the last row of the view projection matrix plus or minus one of the others.
+void GLRenderer::updateFrustumPlanes() {
+  glm::mat4 viewProjection = m_proj * m_view * m_model;
+  glm::vec4 rows[4];
+  for (int i = 0; i < 4; i++) {
+      rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+  }
+  for (int i = 0; i < 3; i++) {
+      m_frustumPlanes[2 * i] = rows[3] + rows[i];
+      m_frustumPlanes[2 * i + 1] = rows[3] - rows[i];
+  }
+}
+
+// Whether the box around a section is at least partly inside every frustum plane.
+bool GLRenderer::isSectionInFrustum(const std::pair<int, int> &chunkKey, int section) const {
+  int size = TerrainGenerator::chunkSize;
+  int bottom = section * ChunkColumn::sectionHeight;
+  glm::vec3 min = TerrainGenerator::getBlockCenter(chunkKey.first * size, chunkKey.second * size, bottom) - glm::vec3(0.5f);
+  glm::vec3 max = min + glm::vec3(size, size, ChunkColumn::sectionHeight);
+
+  for (const glm::vec4 &plane : m_frustumPlanes) {
+      // The corner furthest along the plane normal
+      glm::vec3 corner(plane.x > 0 ? max.x : min.x, plane.y > 0 ? max.y : min.y, plane.z > 0 ? max.z : min.z);
+      if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) {
+          return false;
+      }
+  }
+  return true;
+}
+
 void GLRenderer::rebuildCameraMatrices(int w, int h)
 {
   // Initialize cameraUp
-  cameraUp = glm::vec3(0, 0, 1);  // Assuming Z-axis is up
+  glm::vec3 cameraUp = glm::vec3(0, 0, 1);  // Assuming Z-axis is up
 
   // Calculate the eye position based on m_angleX, m_angleY, and m_zoom
   glm::mat4 rotX = glm::rotate(glm::radians(-10 * m_angleX), glm::vec3(0, 0, 1));
@@ -461,10 +539,11 @@ void GLRenderer::rebuildCameraMatrices(int w, int h)
   eye *= m_zoom;
 
   // Set cameraPos to the calculated eye position
-  cameraPos = glm::vec3(0, 0, eye.z);
+  m_simulation.cameraPos = glm::vec3(0, 0, eye.z);
+  m_simulation.cameraUp = cameraUp;
 
   // Calculate the direction the camera is facing
-  cameraFront = glm::normalize(glm::vec3(0, 0, 0) - eye); // Assuming the camera is looking at (0,0,0)
+  m_simulation.cameraFront = glm::normalize(glm::vec3(0, 0, 0) - eye); // Assuming the camera is looking at (0,0,0)
 
   // Create the view matrix
   m_view = glm::lookAt(eye, glm::vec3(0, 0, 0), cameraUp);
@@ -476,24 +555,64 @@ void GLRenderer::rebuildCameraMatrices(int w, int h)
 }
 
 void GLRenderer::keyPressEvent(QKeyEvent *event) {
-  m_keyMap[Qt::Key(event->key())] = true;
+  setInputKey(event->key(), true);
+
+  // B prints the meshing benchmark, P toggles post-processing, O toggles the baked ambient occlusion
+  if (event->key() == Qt::Key_B) {
+      m_simulation.input.runBenchmark = true;
+      std::cout << "Steady frames that allocated: " << m_allocatingFrames << " of " << m_steadyFrames << std::endl;
+  }
+  if (event->key() == Qt::Key_P) {
+      m_postProcessing = !m_postProcessing;
+  }
+  if (event->key() == Qt::Key_O) {
+      m_simulation.input.toggleAmbientOcclusion = true;
+  }
 }
 
 void GLRenderer::keyReleaseEvent(QKeyEvent *event) {
-  m_keyMap[Qt::Key(event->key())] = false;
+  setInputKey(event->key(), false);
 
 }
 
+// Passes the held movement keys on to the simulation thread.
+void GLRenderer::setInputKey(int key, bool pressed) {
+  InputState &input = m_simulation.input;
+  switch (key) {
+  case Qt::Key_W:     input.forward = pressed; break;
+  case Qt::Key_S:     input.back = pressed; break;
+  case Qt::Key_A:     input.left = pressed; break;
+  case Qt::Key_D:     input.right = pressed; break;
+  case Qt::Key_Space: input.jump = pressed; break;
+  case Qt::Key_T:     input.torch = pressed; break;
+  case Qt::Key_Left:  input.turnLeft = pressed; break;
+  case Qt::Key_Right: input.turnRight = pressed; break;
+  case Qt::Key_Up:    input.turnUp = pressed; break;
+  case Qt::Key_Down:  input.turnDown = pressed; break;
+  default: break;
+  }
+}
+
+// Dragging with the left button turns the camera, a left click without dragging breaks the block in the
+// middle of the view and a right click places one against it.
 void GLRenderer::mousePressEvent(QMouseEvent *event) {
   if (event->buttons().testFlag(Qt::LeftButton)) {
       m_mouseDown = true;
       m_prev_mouse_pos = glm::vec2(event->position().x(), event->position().y());
+      m_mousePressPos = m_prev_mouse_pos;
+  }
+  if (event->button() == Qt::RightButton) {
+      m_simulation.input.placeBlock = true;
   }
 }
 
 void GLRenderer::mouseReleaseEvent(QMouseEvent *event) {
-  if (!event->buttons().testFlag(Qt::LeftButton)) {
+  if (m_mouseDown && !event->buttons().testFlag(Qt::LeftButton)) {
       m_mouseDown = false;
+      glm::vec2 position(event->position().x(), event->position().y());
+      if (glm::distance(position, m_mousePressPos) < 4) {
+          m_simulation.input.breakBlock = true;
+      }
   }
 }
 
@@ -523,198 +642,26 @@ void GLRenderer::mouseMoveEvent(QMouseEvent *event) {
 //          deltaY *= 3;
 //      }
 
-      // rotation speed from assignment
-      float rotationSpeed = m_rotationSpeed;
-
-      // Calculate the new front vector
-      glm::mat4 rotator;
+      // Only record the drag here, it is applied on the next simulation step so the camera
+      // turns the same way however often mouse events arrive
       if (m_mouseDown) {
-
-      // Rotate around the vertical (world Y) axis
-      if (deltaX != 0) {
-          float angleX = -deltaX * rotationSpeed;
-          rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
-          cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
-          cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
-      }
-
-      // Rotate around the horizontal axis (cross product of camera's up and front)
-      if (deltaY != 0) {
-          glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
-          float angleY = -deltaY * rotationSpeed;
-          rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
-          cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
-          cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
-      }
+          m_simulation.input.mouseDeltaX += deltaX;
+          m_simulation.input.mouseDeltaY += deltaY;
       }
 
-      // normalize vectors
-      cameraFront = glm::normalize(cameraFront);
-      cameraUp = glm::normalize(cameraUp);
-
-      // update camera with the new vectors
-      updateCamera();
-      update();
-
 //      QCursor::setPos(mapToGlobal(QPoint(width() / 2, height() / 2)));
 }
 
 void GLRenderer::timerEvent(QTimerEvent *event) {
-  int elapsedms   = m_elapsedTimer.elapsed();
-  float deltaTime = elapsedms * 0.001f;
-  m_elapsedTimer.restart();
-
-  // speed of 5, multiply by deltatime to account for specs from handout
-  float speed = movementSpeed;
-  float distance = speed * deltaTime;
-
-  glm::mat4 rotator = glm::mat4(1.0f);
-  if (m_keyMap[Qt::Key_Left]){
-      float angleX = 5;
-      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
-  }
-
-  if (m_keyMap[Qt::Key_Right]){
-      float angleX = -5;
-      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
-  }
-
-  if (m_keyMap[Qt::Key_Up]){
-      glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
-      float angleY = 3.5;
-      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
-  }
-
-  if (m_keyMap[Qt::Key_Down]){
-      glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
-      float angleY = -3.5;
-      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
-  }
-
-  if (rotator != glm::mat4(1.0f)){
-      cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
-      cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
-      cameraFront = glm::normalize(cameraFront);
-      cameraUp = glm::normalize(cameraUp);
-      updateCamera();
-      update();
-  }
-
-
-  // if s is pressed move backwards in x-y look direction
-  if (m_keyMap[Qt::Key_S]) {
-      glm::vec3 posOffset = -distance * glm::normalize(glm::vec3(cameraFront.x, cameraFront.y, 0.f));
-      int blockIn = generator.getGroundHeight(cameraPos + posOffset);
-      cameraPos = (blockIn == 1) ? cameraPos + posOffset : (blockIn == 2) ? cameraPos + posOffset / 3.5f : cameraPos;
-  }
-
-  // if w is pressed move forwards in x-y look direction
-  if (m_keyMap[Qt::Key_W]) {
-      glm::vec3 posOffset = distance * glm::normalize(glm::vec3(cameraFront.x, cameraFront.y, 0.f));
-      int blockIn = generator.getGroundHeight(cameraPos + posOffset);
-      cameraPos = (blockIn == 1) ? cameraPos + posOffset : (blockIn == 2) ? cameraPos + posOffset / 3.5f : cameraPos;
-  }
-
-  // if A is pressed move to the left of the cross product of up and front vectors
-  if (m_keyMap[Qt::Key_A]) {
-      glm::vec3 posOffset = -glm::normalize(glm::cross(cameraFront, cameraUp)) * distance;
-      int blockIn = generator.getGroundHeight(cameraPos + posOffset);
-      cameraPos = (blockIn == 1) ? cameraPos + posOffset : (blockIn == 2) ? cameraPos + posOffset / 3.5f : cameraPos;
-  }
-
-  // if D is pressed move to the right of the cross product of up and front vectors
-  if (m_keyMap[Qt::Key_D]) {
-      glm::vec3 posOffset = glm::normalize(glm::cross(cameraFront, cameraUp)) * distance;
-      int blockIn = generator.getGroundHeight(cameraPos + posOffset);
-      cameraPos = (blockIn == 1) ? cameraPos + posOffset : (blockIn == 2) ? cameraPos + posOffset / 3.5f : cameraPos;
-  }
-
-  bool inWater = (generator.getGroundHeight(cameraPos) == 2) ? true : false;
-  swimTimer = (swimTimer > 0.9) ? 0 : swimTimer + deltaTime;
-
-  // translate camera among world space vector up
-  if (m_keyMap[Qt::Key_Space]) {
-
-      if (!inTheAir || (inWater && !swimTimer)){
-          inTheAir = true;
-          velocity = (inWater) ? reboundVelocity / 1.8f : reboundVelocity;
-      }
-  }
-
-  if (m_keyMap[Qt::Key_T]) {
-      lightTypes.push_back(0);
-      glm::vec3 posOffset = 5*distance * glm::normalize(glm::vec3(cameraFront.x, cameraFront.y, 0.f));
-
-      glm::vec3 lightPos = cameraPos + posOffset;
-      lightPositions.push_back(glm::vec4(lightPos,1.0));
-      lightDirections.push_back(glm::vec4(1.0));
-      attenuationFunctions.push_back(glm::vec3(0.4, 0.4, 0.0));
-      lightColors.push_back(glm::vec3(0.96,0.60,0.24));
-  }
-
-  // Jump movement stuff
-  velocity = fmax(velocity + ((inWater) ? acceleration / 1.75f : acceleration)*deltaTime, minimumVelocity);
-  glm::vec3 newPos = glm::vec3(cameraPos.x, cameraPos.y, cameraPos.z + velocity*deltaTime);
-  if (!generator.getGroundHeight(newPos)) {
-      velocity = 0;
-      inTheAir = false;
-  }
-  else cameraPos = newPos;
-
-  // update player position in terrain generator so it knows what chunks to load
-  cubesVector = generator.updatePlayerPosition(cameraPos, cubesVector, false);
-  populateBlockMap();
-
-  float maxDistance = 30.0f; // Set your distance threshold
-  filterTorches(maxDistance);
-
-  // recalculate viewMatrix with the updated parameters
-  updateCamera();
-  update(); // asks for a PaintGL() call to occur
-}
-
-void GLRenderer::updateCamera() {
-  m_view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-  // Update m_proj here if needed, for example:
+  // The simulation steps on its own thread, the timer only asks for a new frame
   update();
 }
 
-void GLRenderer::initTextureMap(){
-  for (float row = 0; row < 16; row++){
-      for (float col = 0; col < 16; col++){
-          textureMap[(row * 16) + col] = glm::vec2((col / 16.f), (15 - row) / 16.f);
-      }
-  }
-}
-
-void GLRenderer::populateBlockMap(){
-  for(const auto& shape : cubesVector){
-      if (shape->getID() != 5){
-          glm::vec3 position = shape->getPosition();
-          blockMap[{position[0], position[1], position[2]}] = true;
-      }
-  }
-}
-
-void GLRenderer::filterTorches(float maxDistance) {
-    std::vector<size_t> indicesToRemove;
-
-    // Find indices to remove
-    for (size_t i = 1; i < lightPositions.size(); ++i) {
-        if (glm::distance(glm::vec3(lightPositions[i]), cameraPos) > maxDistance) {
-            indicesToRemove.push_back(i);
-        }
-    }
-
-    // Sort the indices in reverse order
-    std::sort(indicesToRemove.rbegin(), indicesToRemove.rend());
-
-    // Remove elements from all vectors
-    for (size_t index : indicesToRemove) {
-        lightPositions.erase(lightPositions.begin() + index);
-        attenuationFunctions.erase(attenuationFunctions.begin() + index);
-        lightColors.erase(lightColors.begin() + index);
-        lightDirections.erase(lightDirections.begin() + index);
-        lightTypes.erase(lightTypes.begin() + index);
-    }
+// Rebuilds the view matrix part way between the last two simulation steps of the snapshot, based on
+// how long ago the newest step was due.
+void GLRenderer::updateCamera(const FrameSnapshot &snapshot) {
+  float sinceStep = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.stepTime).count();
+  float alpha = glm::clamp(sinceStep / Simulation::fixedTimeStep, 0.f, 1.f);
+  glm::vec3 eye = glm::mix(snapshot.previousCameraPos, snapshot.cameraPos, alpha);
+  m_view = glm::lookAt(eye, eye + snapshot.cameraFront, snapshot.cameraUp);
 }
@@ -13,9 +13,11 @@
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <iostream>
-#include <unordered_map>
 #include "cube.h"
-#include "terraingenerator.h"
+#include "chunkmesher.h"
+#include "resolutionscaler.h"
+#include "simulation.h"
+#include "framearena.h"
 
 
 class GLRenderer : public QOpenGLWidget
@@ -35,6 +37,8 @@ protected:
 
 private:
     void makeFBO();
+    void deleteFBO();
+    void updateRenderScale();
     // Task 30: Update the paintTexture function signature
     void paintTexture(GLuint texture, bool postProcessing);
     void initializeExampleGeometry();
@@ -48,70 +52,77 @@ private:
     void mouseReleaseEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void timerEvent(QTimerEvent *event) override;
-    void updateCamera();
+    void setInputKey(int key, bool pressed);
+    void updateCamera(const FrameSnapshot &snapshot);
 
-    TerrainGenerator generator;
+    Simulation m_simulation; // owns the world, stepped on its own thread
 
     int m_devicePixelRatio;
     GLuint m_defaultFBO;
     int m_fbo_width;
     int m_fbo_height;
+    float m_renderScale = 1.0f; // fraction of the screen resolution the scene FBO was built at
+
+    ResolutionScaler m_resolutionScaler;
+    QElapsedTimer m_frameTimer;                         // CPU time spent in paintGL()
+    FrameArena m_frameArena;                            // lists that only live for one frame, reset at the end of paintGL()
+    int m_steadyFrames = 0;                             // frames that uploaded no mesh
+    int m_allocatingFrames = 0;                         // of those, the ones that still went to the heap. Debug builds only
+    GLuint m_frameQueries[2];                           // GPU time of the last two frames
+    bool m_frameQueryIssued[2] = {false, false};
+    int m_frameQueryIndex = 0;
+    float m_lastFrameTime = 0;                          // ms, larger of the CPU and GPU time of the last frame
     int m_screen_width;
     int m_screen_height;
 
-    std::vector<int> lightTypes;
-    std::vector<glm::vec4> lightPositions;
-    std::vector<glm::vec4> lightDirections;
-    std::vector<glm::vec3> attenuationFunctions;
-    std::vector<glm::vec3> lightColors;
-
-    glm::vec3 cameraPos;
-    glm::vec3 cameraFront;
-    glm::vec3 cameraUp;
-    float cameraSpeed;
-
     int m_timer;                                        // Stores timer which attempts to run ~60 times per second
     QElapsedTimer m_elapsedTimer;                       // Stores timer which keeps track of actual time between frames
 
     // Input Related Variables
     bool m_mouseDown = false;                           // Stores state of left mouse button
     glm::vec2 m_prev_mouse_pos;
+    glm::vec2 m_mousePressPos;                          // where the left button went down, releasing it close by is a click
 
     SceneCameraData m_renderData;
 
-
-    std::unordered_map<Qt::Key, bool> m_keyMap;         // Stores whether keys are pressed or not
-
     GLuint m_texture_shader;
     GLuint m_fullscreen_vbo;
     GLuint m_fullscreen_vao;
     QImage m_image;
-    GLuint m_fbo;
+    GLuint m_fbo = 0; // only allocated while a post effect is active
     GLuint m_fbo_texture;
     GLuint m_fbo_renderbuffer;
 
     GLuint m_phong_shader;
-    std::vector<float> m_cube_data;
-    GLuint m_cube_vbo;
-    GLuint m_cube_vao;
-    float movementSpeed = 7.f;
-    float m_rotationSpeed = 0.2f;
-    float velocity = 0;
-    float reboundVelocity = 9;
-    float acceleration = -20;
-    float minimumVelocity = -12;
-    bool inTheAir = false;
-    float swimTimer = 0;
+    bool m_postProcessing = false; // inverts the scene through the offscreen FBO, toggled with P
 
     GLuint m_grass_texture;
 
-    std::map<int, glm::vec2> textureMap;
-    void initTextureMap();
-    std::map<std::tuple<float, float, float>, bool> blockMap;
+    // GPU copy of a chunk mesh. The opaque vertices of every section come first in the buffer, followed
+    // by the water vertices, and each section remembers its two ranges so it can be culled on its own.
+    struct SectionRange {
+        int section;
+        GLint opaqueFirst;
+        GLsizei opaqueCount;
+        GLint waterFirst;
+        GLsizei waterCount;
+    };
+    struct ChunkMeshGL {
+        GLuint vao;
+        GLuint vbo;
+        std::vector<SectionRange> sections;
+        std::shared_ptr<const ChunkMesh> source; // the snapshot mesh this was uploaded from
+    };
+    std::map<std::pair<int, int>, ChunkMeshGL> m_chunkMeshes;
+    std::shared_ptr<const ChunkMeshMap> m_syncedChunkMeshes; // snapshot map m_chunkMeshes matches
+    // True when a mesh was uploaded or deleted.
+    bool syncChunkMeshes(const FrameSnapshot &snapshot);
+    void uploadChunkMesh(const std::pair<int, int> &key, const std::shared_ptr<const ChunkMesh> &mesh);
 
-    std::vector<Cube*> cubesVector = std::vector<Cube*>();
-    void populateBlockMap();
-    void filterTorches(float maxDistance);
+    // Planes of the view frustum as (normal, distance) pointing inwards, taken from the matrices each frame.
+    glm::vec4 m_frustumPlanes[6];
+    void updateFrustumPlanes();
+    bool isSectionInFrustum(const std::pair<int, int> &chunkKey, int section) const;
 
     glm::mat4 m_model = glm::mat4(1);
     glm::mat4 m_view = glm::mat4(1);
@@ -124,21 +135,6 @@ private:
     float m_zoom;
     bool m_mouseSnap = true;
 
-    enum blockType {
-        gravel = 0,
-        stone = 1,
-        dirt = 2,
-        grassSide = 3,
-        woodPlank = 4,
-        cobblestone = 16,
-        bedrock = 17,
-        sand = 18,
-        logSide = 20,
-        logCap = 21,
-        grassTop = 39,
-        leaves = 40,
-        water = 178
-    };
     struct light{
         int type;
         glm::vec3 pos;
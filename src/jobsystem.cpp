@@ -0,0 +1,187 @@
+#include "jobsystem.h"
+#include <algorithm>
+
+namespace {
+
+// Index of the worker running on this thread, or -1 outside the JobSystem's workers.
+thread_local int t_workerIndex = -1;
+thread_local const JobSystem *t_workerOwner = nullptr;
+
+}
+
+JobSystem::JobSystem(int workerCount)
+    : m_statsStart(std::chrono::steady_clock::now())
+{
+    for (int i = 0; i < std::max(workerCount, 1); i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < (int) m_workers.size(); i++) {
+        m_workers[i]->thread = std::thread(&JobSystem::run, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+int JobSystem::defaultWorkerCount() {
+    return std::max((int) std::thread::hardware_concurrency() - 2, 1);
+}
+
+JobHandle JobSystem::submit(std::function<void()> work, float priority, std::span<const JobHandle> dependencies) {
+    JobHandle job = std::make_shared<Job>();
+    job->work = std::move(work);
+    job->priority = priority;
+
+    // The extra count held while registering keeps a dependency finishing meanwhile from queuing the job early.
+    job->pendingDependencies = 1 + dependencies.size();
+    for (const JobHandle &dependency : dependencies) {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->finished) {
+            job->pendingDependencies--;
+        } else {
+            dependency->dependents.push_back(job);
+            job->dependencies.push_back(dependency);
+        }
+    }
+    if (--job->pendingDependencies == 0) {
+        enqueue(job);
+    }
+    return job;
+}
+
+void JobSystem::wait(const JobHandle &job) {
+    // Anything else queued, such as a long chunk generation, could keep the waiting thread busy for much
+    // longer than the work it waits for
+    std::vector<const Job *> awaited;
+    std::vector<const Job *> stack = {job.get()};
+    while (!stack.empty()) {
+        const Job *next = stack.back();
+        stack.pop_back();
+        if (next->finished || std::find(awaited.begin(), awaited.end(), next) != awaited.end()) {
+            continue;
+        }
+        awaited.push_back(next);
+        for (const JobHandle &dependency : next->dependencies) {
+            stack.push_back(dependency.get());
+        }
+    }
+
+    while (!job->finished) {
+        JobHandle next = take(-1, awaited);
+        if (next) {
+            execute(next, -1);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::vector<JobSystem::WorkerStats> JobSystem::takeStats() {
+    auto now = std::chrono::steady_clock::now();
+    float elapsed = std::chrono::duration<float, std::nano>(now - m_statsStart).count();
+    m_statsStart = now;
+
+    std::vector<WorkerStats> stats;
+    for (auto &worker : m_workers) {
+        float busy = worker->busyNanoseconds.exchange(0);
+        stats.push_back({std::min(busy / std::max(elapsed, 1.f), 1.f), worker->jobsRun.exchange(0), worker->steals.exchange(0)});
+    }
+    return stats;
+}
+
+void JobSystem::run(int workerIndex) {
+    t_workerIndex = workerIndex;
+    t_workerOwner = this;
+
+    while (true) {
+        JobHandle job = take(workerIndex);
+        if (job) {
+            execute(job, workerIndex);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_queued > 0 || !m_running; });
+        if (!m_running && m_queued == 0) {
+            return;
+        }
+    }
+}
+
+// Jobs submitted by a worker stay on its own deque, everything else is spread round robin.
+void JobSystem::enqueue(const JobHandle &job) {
+    int index = (t_workerOwner == this) ? t_workerIndex : m_nextWorker++ % m_workers.size();
+    Worker &worker = *m_workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto position = std::upper_bound(worker.jobs.begin(), worker.jobs.end(), job->priority,
+                                         [](float priority, const JobHandle &other) { return priority < other->priority; });
+        worker.jobs.insert(position, job);
+    }
+    m_queued++;
+
+    // Taking the lock orders the count above before a sleeping worker re-checks it
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+// Pops the most urgent job of our own deque, or steals the most urgent one of another worker.
+// Thieves take from the front too so priorities still hold once work spreads out. When only is given,
+// just the most urgent of those jobs.
+JobHandle JobSystem::take(int workerIndex, std::span<const Job *const> only) {
+    int count = m_workers.size();
+    int start = (workerIndex >= 0) ? workerIndex : 0;
+    for (int i = 0; i < count; i++) {
+        int index = (start + i) % count;
+        Worker &worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto it = worker.jobs.begin();
+        if (!only.empty()) {
+            it = std::find_if(worker.jobs.begin(), worker.jobs.end(), [&](const JobHandle &job) {
+                return std::find(only.begin(), only.end(), job.get()) != only.end();
+            });
+        }
+        if (it == worker.jobs.end()) {
+            continue;
+        }
+        JobHandle job = std::move(*it);
+        worker.jobs.erase(it);
+        m_queued--;
+        if (workerIndex >= 0 && index != workerIndex) {
+            m_workers[workerIndex]->steals++;
+        }
+        return job;
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(const JobHandle &job, int workerIndex) {
+    auto start = std::chrono::steady_clock::now();
+    job->work();
+    if (workerIndex >= 0) {
+        Worker &worker = *m_workers[workerIndex];
+        worker.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        worker.jobsRun++;
+    }
+
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+        dependents.swap(job->dependents);
+    }
+    for (const JobHandle &dependent : dependents) {
+        if (--dependent->pendingDependencies == 0) {
+            enqueue(dependent);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+// A unit of work queued on the JobSystem. Only the JobSystem touches the fields, everyone else
+// holds a JobHandle to depend on or wait for it.
+struct Job {
+    std::function<void()> work;
+    float priority;
+    std::atomic<int> pendingDependencies{1};
+    std::atomic<bool> finished{false};
+    std::mutex mutex;                            // guards dependents
+    std::vector<std::shared_ptr<Job>> dependents;
+    std::vector<std::shared_ptr<Job>> dependencies; // the ones not yet finished at submit, for wait
+};
+using JobHandle = std::shared_ptr<Job>;
+
+// Work stealing scheduler for world tasks such as chunk generation and meshing. Every worker has
+// its own deque kept in priority order, idle workers steal from the others, and a job only becomes
+// runnable once every job it depends on has finished.
+class JobSystem
+{
+public:
+    // Defaults to every core except the two used by the GUI and simulation threads.
+    JobSystem(int workerCount = defaultWorkerCount());
+    ~JobSystem();
+
+    // Lower priorities run first, callers use the distance to the player.
+    JobHandle submit(std::function<void()> work, float priority = 0, std::span<const JobHandle> dependencies = {});
+    JobHandle submit(std::function<void()> work, float priority, std::initializer_list<JobHandle> dependencies) {
+        return submit(std::move(work), priority, std::span<const JobHandle>(dependencies.begin(), dependencies.size()));
+    }
+
+    // Runs the job and whatever it depends on on the calling thread, as far as they are still queued,
+    // until the job has finished. Other queued jobs are left to the workers.
+    void wait(const JobHandle &job);
+
+    // True once the job has run, without waiting for it.
+    static bool isFinished(const JobHandle &job) { return job->finished; }
+
+    int getWorkerCount() const { return m_workers.size(); }
+    static int defaultWorkerCount();
+
+    struct WorkerStats {
+        float utilisation; // fraction of the time since the last call spent running jobs
+        uint64_t jobs;
+        uint64_t steals;   // jobs taken from another worker's deque
+    };
+    // Stats per worker since the last call.
+    std::vector<WorkerStats> takeStats();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs; // most urgent at the front
+        std::thread thread;
+        std::atomic<int64_t> busyNanoseconds{0};
+        std::atomic<uint64_t> jobsRun{0};
+        std::atomic<uint64_t> steals{0};
+    };
+
+    void run(int workerIndex);
+    void enqueue(const JobHandle &job);
+    JobHandle take(int workerIndex, std::span<const Job *const> only = {});
+    void execute(const JobHandle &job, int workerIndex);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_queued{0};       // jobs sitting in any deque
+    std::atomic<unsigned> m_nextWorker{0};
+    std::atomic<bool> m_running{true};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::chrono::steady_clock::time_point m_statsStart;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,35 @@
+#include "renderdistancegovernor.h"
+#include <algorithm>
+
+RenderDistanceGovernor::RenderDistanceGovernor(float targetFrameTime, size_t memoryBudget)
+    : m_targetFrameTime(targetFrameTime),
+      m_memoryBudget(memoryBudget),
+      m_averageFrameTime(targetFrameTime * 0.5f)
+{
+}
+
+int RenderDistanceGovernor::update(int renderDistance, float frameTime, int chunkBacklog, int loadedChunks, size_t loadedBytes) {
+    m_averageFrameTime = m_averageFrameTime * 0.95f + frameTime * 0.05f;
+    m_ticksSinceChange++;
+
+    // Memory the window would need one step further out, based on what the loaded chunks cost on average.
+    size_t bytesPerChunk = loadedBytes / std::max(loadedChunks, 1);
+    size_t nextWidth = 2 * (renderDistance + 1) + 1;
+    size_t nextBytes = nextWidth * nextWidth * bytesPerChunk;
+
+    int distance = renderDistance;
+    bool overBudget = m_averageFrameTime > m_targetFrameTime * lowerAbove || loadedBytes > m_memoryBudget;
+    if (overBudget && m_ticksSinceChange >= lowerCooldown) {
+        distance--;
+    } else if (!overBudget && m_ticksSinceChange >= raiseCooldown && chunkBacklog == 0 &&
+               m_averageFrameTime < m_targetFrameTime * raiseBelow && nextBytes < m_memoryBudget * 0.8f) {
+        // Only grow once the current window has finished streaming in.
+        distance++;
+    }
+    distance = std::clamp(distance, minDistance, maxDistance);
+
+    if (distance != renderDistance) {
+        m_ticksSinceChange = 0;
+    }
+    return distance;
+}
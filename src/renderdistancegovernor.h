@@ -0,0 +1,32 @@
+#ifndef RENDERDISTANCEGOVERNOR_H
+#define RENDERDISTANCEGOVERNOR_H
+#include <cstddef>
+
+// Raises or lowers TerrainGenerator::renderDistance at runtime from the cost of each frame,
+// how many chunks are still waiting to be generated and how much memory the loaded chunks use.
+class RenderDistanceGovernor
+{
+public:
+    RenderDistanceGovernor(float targetFrameTime = 1000.f / 60.f, size_t memoryBudget = 64 * 1024 * 1024);
+
+    // Called once per tick with the time spent on the last tick and frame in milliseconds.
+    // Returns the render distance to use from now on.
+    int update(int renderDistance, float frameTime, int chunkBacklog, int loadedChunks, size_t loadedBytes);
+
+    static const int minDistance = 1;
+    static const int maxDistance = 8;
+
+    // Thresholds are far apart and raising waits longer than lowering, so the distance settles instead of oscillating.
+    static constexpr float lowerAbove = 1.2f; // fraction of the target frame time
+    static constexpr float raiseBelow = 0.7f;
+    static const int lowerCooldown = 30;      // ticks
+    static const int raiseCooldown = 120;
+
+private:
+    float m_targetFrameTime;
+    size_t m_memoryBudget;
+    float m_averageFrameTime;
+    int m_ticksSinceChange = 0;
+};
+
+#endif // RENDERDISTANCEGOVERNOR_H
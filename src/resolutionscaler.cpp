@@ -0,0 +1,35 @@
+#include "resolutionscaler.h"
+#include <algorithm>
+
+ResolutionScaler::ResolutionScaler(float targetFrameTime)
+    : m_targetFrameTime(targetFrameTime),
+      m_averageFrameTime(targetFrameTime)
+{
+}
+
+void ResolutionScaler::addFrameTime(float frameTime) {
+    // Smooth out single slow frames, e.g. when a chunk is generated.
+    m_averageFrameTime = m_averageFrameTime * 0.9f + frameTime * 0.1f;
+    if (++m_framesSinceChange < settleFrames) {
+        return;
+    }
+
+    // Drop quickly when over budget, but only raise once there is clear headroom so the scale does not oscillate.
+    const int maxStepsDown = static_cast<int>((maxScale - minScale) / step + 0.5f);
+    int stepsDown = m_stepsDown;
+    if (m_averageFrameTime > m_targetFrameTime * 1.05f) {
+        stepsDown++;
+    } else if (m_averageFrameTime < m_targetFrameTime * 0.75f) {
+        stepsDown--;
+    }
+    stepsDown = std::clamp(stepsDown, 0, maxStepsDown);
+
+    if (stepsDown != m_stepsDown) {
+        m_stepsDown = stepsDown;
+        m_framesSinceChange = 0;
+    }
+}
+
+float ResolutionScaler::getScale() const {
+    return maxScale - m_stepsDown * step;
+}
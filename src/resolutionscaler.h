@@ -0,0 +1,26 @@
+#ifndef RESOLUTIONSCALER_H
+#define RESOLUTIONSCALER_H
+
+// Picks the render scale of the scene FBO from measured frame times so the frame rate holds its target.
+class ResolutionScaler
+{
+public:
+    ResolutionScaler(float targetFrameTime = 1000.f / 60.f);
+
+    // Feeds the time the last frame took in milliseconds.
+    void addFrameTime(float frameTime);
+    float getScale() const;
+
+    static constexpr float minScale = 0.5f;
+    static constexpr float maxScale = 1.0f;
+    static constexpr float step = 0.05f;      // scales snap to this so the FBO is not rebuilt every frame
+    static const int settleFrames = 30;       // frames to wait after a change before judging it
+
+private:
+    float m_targetFrameTime;
+    float m_averageFrameTime;
+    int m_stepsDown = 0; // scale is maxScale - m_stepsDown * step, kept as an int so it returns to exactly 1
+    int m_framesSinceChange = 0;
+};
+
+#endif // RESOLUTIONSCALER_H
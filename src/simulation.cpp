@@ -0,0 +1,474 @@
+#include "simulation.h"
+#include <algorithm>
+#include "glm/gtx/transform.hpp"
+#include "benchmark.h"
+#include <iostream>
+
+Simulation::Simulation()
+{
+    generator.jobs = &m_jobs;
+    generator.frameArena = &m_frameArena;
+    generator.listener = this;
+
+    lightTypes.push_back(1);
+    lightPositions.push_back(glm::vec4(10.0, 0.0, 0.0,1.0));
+    lightDirections.push_back(glm::vec4(0.0, 0.0, -1.0,1.0f));
+    attenuationFunctions.push_back(glm::vec3(0.0, 0.0, 0.0f));
+    lightColors.push_back(glm::vec3(1.0,1.0,1.0));
+}
+
+Simulation::~Simulation()
+{
+    stop();
+    // Nothing may be left queued on m_jobs that calls back into the generator once it is destroyed
+    generator.cancelPendingChunks();
+}
+
+void Simulation::start()
+{
+    // Load every chunk around the player up front so the first frame is complete
+    do {
+        generator.updatePlayerPosition(cameraPos);
+        generator.waitForPendingChunks();
+    } while (generator.chunkBacklog > 0);
+    m_previousCameraPos = cameraPos;
+    updateChunkMeshes();
+    publishSnapshot(std::chrono::steady_clock::now());
+    m_frameArena.reset();
+
+    m_running = true;
+    m_thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop()
+{
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+// Steps at a fixed rate on our own clock. Each snapshot is stamped with the time its step was due,
+// which the renderer uses to interpolate the camera between the last two steps.
+void Simulation::run()
+{
+    using clock = std::chrono::steady_clock;
+    const auto stepDuration = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(fixedTimeStep));
+
+    auto nextStep = clock::now() + stepDuration;
+    m_frameArena.reset(); // heap allocations are counted per thread, start counting on this one
+    while (m_running) {
+        std::this_thread::sleep_until(nextStep);
+
+        int steps = 0;
+        clock::time_point stepTime;
+        while (nextStep <= clock::now() && steps < maxStepsPerWake) {
+            step(fixedTimeStep);
+            stepTime = nextStep;
+            nextStep += stepDuration;
+            steps++;
+        }
+        if (steps > 0) {
+            publishSnapshot(stepTime);
+        }
+
+        // Drop whatever we could not catch up on after a long stall
+        if (nextStep <= clock::now()) {
+            nextStep = clock::now() + stepDuration;
+        }
+    }
+}
+
+void Simulation::step(float deltaTime) {
+  auto stepStart = std::chrono::steady_clock::now();
+  m_previousCameraPos = cameraPos;
+
+  // Requests from the GUI thread that touch the world are run here, between steps
+  bool steady = generator.pendingChunks.empty() && !input.torch;
+  if (input.runBenchmark.exchange(false)) {
+      steady = false;
+      std::cout << "Steady steps that allocated: " << m_allocatingSteps << " of " << m_steadySteps << std::endl;
+      Benchmark::printWorkerStats(m_jobs);
+      std::cout << "Chunks cancelled before use: " << generator.chunksCancelled << std::endl;
+      const ChunkCache &cache = generator.cachedChunkMatrices2;
+      std::cout << "Chunk cache: " << cache.count() << " chunks in " << cache.getBytes() / 1024 << " KB, "
+                << cache.getModifiedCount() << " modified, " << cache.getSpilledCount() << " modified on disk, "
+                << cache.evicted << " evicted" << std::endl;
+      Benchmark::printChunkMemory(generator);
+      Benchmark::runRaycasts(generator);
+      Benchmark::runMeshing(generator);
+      Benchmark::runSectionDimensions(generator);
+      Benchmark::runSectionLayouts(generator);
+      Benchmark::runJobScaling(generator);
+  }
+  if (input.breakBlock.exchange(false)) {
+      breakBlock();
+  }
+  if (input.placeBlock.exchange(false)) {
+      placeBlock();
+  }
+  if (input.toggleAmbientOcclusion.exchange(false)) {
+      m_mesher.ambientOcclusion = !m_mesher.ambientOcclusion;
+      m_remeshAll = true;
+  }
+
+  // rotation speed from assignment
+  float rotationSpeed = m_rotationSpeed;
+
+  // Apply the mouse drag recorded since the last step
+  int mouseDeltaX = input.mouseDeltaX.exchange(0);
+  int mouseDeltaY = input.mouseDeltaY.exchange(0);
+  if (mouseDeltaX != 0) {
+      float angleX = -mouseDeltaX * rotationSpeed;
+      glm::mat4 rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
+      cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
+      cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
+  }
+
+  // Rotate around the horizontal axis (cross product of camera's up and front)
+  if (mouseDeltaY != 0) {
+      glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+      float angleY = -mouseDeltaY * rotationSpeed;
+      glm::mat4 rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
+      cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
+      cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
+  }
+  cameraFront = glm::normalize(cameraFront);
+  cameraUp = glm::normalize(cameraUp);
+
+  // speed of 5, multiply by deltatime to account for specs from handout
+  float speed = movementSpeed;
+  float distance = speed * deltaTime;
+
+  glm::mat4 rotator = glm::mat4(1.0f);
+  if (input.turnLeft){
+      float angleX = 5;
+      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
+  }
+
+  if (input.turnRight){
+      float angleX = -5;
+      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleX), glm::vec3(0, 0, 1));
+  }
+
+  if (input.turnUp){
+      glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+      float angleY = 3.5;
+      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
+  }
+
+  if (input.turnDown){
+      glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+      float angleY = -3.5;
+      rotator = glm::rotate(glm::mat4(1.0f), glm::radians(angleY), right);
+  }
+
+  if (rotator != glm::mat4(1.0f)){
+      cameraFront = glm::vec3(rotator * glm::vec4(cameraFront, 0.0));
+      cameraUp = glm::vec3(rotator * glm::vec4(cameraUp, 0.0));
+      cameraFront = glm::normalize(cameraFront);
+      cameraUp = glm::normalize(cameraUp);
+  }
+
+
+  // w and s move along the x-y look direction, a and d to the sides of it. The keys add up and the
+  // player box is swept through the blocks in one go, sliding along walls and stepping up ledges.
+  glm::vec3 forward = glm::normalize(glm::vec3(cameraFront.x, cameraFront.y, 0.f));
+  glm::vec3 right = glm::normalize(glm::cross(cameraFront, cameraUp));
+  right = glm::normalize(glm::vec3(right.x, right.y, 0.f));
+  glm::vec3 movement(0);
+  if (input.forward) movement += forward;
+  if (input.back) movement -= forward;
+  if (input.left) movement -= right;
+  if (input.right) movement += right;
+
+  bool inWater = isInWater();
+  movement *= inWater ? distance / 3.5f : distance;
+  if (movement != glm::vec3(0)) {
+      Sweep sweep = inTheAir ? sweepBox(m_world, getPlayerBox(), movement)
+                             : stepBox(m_world, getPlayerBox(), movement, stepHeight);
+      cameraPos += sweep.moved;
+  }
+
+  swimTimer = (swimTimer > 0.9) ? 0 : swimTimer + deltaTime;
+
+  // translate camera among world space vector up
+  if (input.jump) {
+
+      if (!inTheAir || (inWater && !swimTimer)){
+          inTheAir = true;
+          velocity = (inWater) ? reboundVelocity / 1.8f : reboundVelocity;
+      }
+  }
+
+  if (input.torch) {
+      lightTypes.push_back(0);
+      glm::vec3 posOffset = 5*distance * glm::normalize(glm::vec3(cameraFront.x, cameraFront.y, 0.f));
+
+      glm::vec3 lightPos = cameraPos + posOffset;
+      lightPositions.push_back(glm::vec4(lightPos,1.0));
+      lightDirections.push_back(glm::vec4(1.0));
+      attenuationFunctions.push_back(glm::vec3(0.4, 0.4, 0.0));
+      lightColors.push_back(glm::vec3(0.96,0.60,0.24));
+  }
+
+  // Jump movement stuff, the player is on the ground once a block stops it falling
+  velocity = fmax(velocity + ((inWater) ? acceleration / 1.75f : acceleration)*deltaTime, minimumVelocity);
+  Sweep fall = sweepBox(m_world, getPlayerBox(), glm::vec3(0, 0, velocity * deltaTime));
+  cameraPos += fall.moved;
+  inTheAir = !(fall.blocked.z && velocity < 0);
+  if (fall.blocked.z) {
+      velocity = 0;
+  }
+
+  // pick the render distance from the cost of the last step and frame, they run on different threads
+  // so the slower of the two sets the pace. Then let the terrain generator stream chunks around the
+  // new player position and mesh whatever changed.
+  float frameTime = std::max(m_lastStepTime, lastFrameTime.load());
+  generator.renderDistance = m_renderDistanceGovernor.update(generator.renderDistance, frameTime,
+                                                             generator.chunkBacklog, generator.getChunkMatrices().count(),
+                                                             generator.getLoadedBytes());
+  generator.lookDirection = cameraFront;
+  generator.updatePlayerPosition(cameraPos);
+  if (!m_addedChunks.empty() || !m_removedChunks.empty() || !m_modifiedSections.empty() || m_remeshAll) {
+      steady = false;
+      updateChunkMeshes();
+  }
+
+  float maxDistance = 30.0f; // Set your distance threshold
+  filterTorches(maxDistance);
+
+  // A step that loaded and meshed nothing should not have gone to the heap, debug builds check
+  m_frameArena.reset();
+  if (steady) {
+      m_steadySteps++;
+      m_allocatingSteps += m_frameArena.getHeapAllocations() > 0;
+  }
+
+  m_lastStepTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - stepStart).count();
+}
+
+void Simulation::chunkAdded(const std::pair<int, int> &chunkKey) {
+  m_addedChunks.insert(chunkKey);
+}
+
+void Simulation::chunkRemoved(const std::pair<int, int> &chunkKey) {
+  m_removedChunks.insert(chunkKey);
+}
+
+void Simulation::chunkModified(const std::pair<int, int> &chunkKey, int section) {
+  m_modifiedSections.insert({chunkKey, section});
+}
+
+// Builds meshes for the chunks the generator reported as added and the sections it reported as modified, and
+// drops the meshes of removed chunks. Published snapshots share the mesh map, so changes go into a copy that
+// replaces it.
+void Simulation::updateChunkMeshes() {
+  const auto &chunks = generator.getChunkMatrices();
+  auto chunkMeshes = std::make_shared<ChunkMeshMap>(*m_chunkMeshes);
+
+  for (const auto &chunkKey : m_removedChunks) {
+      chunkMeshes->erase(chunkKey);
+  }
+
+  // A new chunk changes the border faces and occlusion of its neighbours, so those are rebuilt too.
+  FrameVector<std::pair<int, int>> dirty(&m_frameArena);
+  if (m_remeshAll) {
+      for (const auto &chunk : chunks) {
+          dirty.push_back(chunk.key);
+      }
+  }
+  for (const auto &chunkKey : m_addedChunks) {
+      for (int dx = -1; dx <= 1; dx++) {
+          for (int dy = -1; dy <= 1; dy++) {
+              std::pair<int, int> key = {chunkKey.first + dx, chunkKey.second + dy};
+              if (chunks.contains(key)) {
+                  dirty.push_back(key);
+              }
+          }
+      }
+  }
+
+  std::sort(dirty.begin(), dirty.end());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+
+  // Block edits only rebuild the sections they touched, unless their whole chunk is rebuilt anyway. They are
+  // next to the player, so they go ahead of everything else.
+  FrameVector<std::pair<std::pair<int, int>, int>> dirtySections(&m_frameArena);
+  for (const auto &modified : m_modifiedSections) {
+      if (chunks.contains(modified.first) && !std::binary_search(dirty.begin(), dirty.end(), modified.first)) {
+          dirtySections.push_back(modified);
+      }
+  }
+  std::vector<SectionMesh> sectionMeshes(dirtySections.size());
+
+  // Mesh every section of the dirty chunks as its own job. Nothing changes the generator until they have
+  // all finished, so they can read it without locking.
+  const FrameVector<std::pair<int, int>> &keys = dirty;
+  std::vector<ChunkMesh> meshes(keys.size());
+  FrameVector<JobHandle> meshing(&m_frameArena);
+  for (size_t i = 0; i < keys.size(); i++) {
+      const ChunkBlocks &chunk = *chunks.find(keys[i]);
+      meshes[i].sections.resize(chunk.getSectionCount());
+      for (int section = 0; section < chunk.getSectionCount(); section++) {
+          if (ChunkColumn::isEmpty(chunk.getSection(section))) {
+              continue;
+          }
+          meshing.push_back(m_jobs.submit([this, &keys, &meshes, i, section] {
+              meshes[i].sections[section] = m_mesher.buildSectionMesh(keys[i].first, keys[i].second, section);
+          }, getChunkPriority(keys[i])));
+      }
+  }
+  for (size_t i = 0; i < dirtySections.size(); i++) {
+      const auto &[chunkKey, section] = dirtySections[i];
+      const ChunkBlocks &chunk = *chunks.find(chunkKey);
+      sectionMeshes[i].section = section;
+      if (section >= chunk.getSectionCount() || ChunkColumn::isEmpty(chunk.getSection(section))) {
+          continue;
+      }
+      meshing.push_back(m_jobs.submit([this, &dirtySections, &sectionMeshes, i] {
+          const auto &[chunkKey, section] = dirtySections[i];
+          sectionMeshes[i] = m_mesher.buildSectionMesh(chunkKey.first, chunkKey.second, section);
+      }, 0));
+  }
+  m_jobs.wait(m_jobs.submit([] {}, 0, meshing));
+
+  // Edited chunks keep the meshes of their other sections, the rebuilt ones take the place of the old ones.
+  // dirtySections is sorted by chunk, then section.
+  for (size_t begin = 0, end = 0; begin < dirtySections.size(); begin = end) {
+      const std::pair<int, int> &chunkKey = dirtySections[begin].first;
+      while (end < dirtySections.size() && dirtySections[end].first == chunkKey) {
+          end++;
+      }
+      ChunkMesh mesh;
+      auto it = chunkMeshes->find(chunkKey);
+      if (it != chunkMeshes->end()) {
+          mesh = *it->second;
+      }
+      std::erase_if(mesh.sections, [&](const SectionMesh &section) {
+          return std::any_of(dirtySections.begin() + begin, dirtySections.begin() + end, [&](const auto &dirtySection) {
+              return dirtySection.second == section.section;
+          });
+      });
+      for (size_t i = begin; i < end; i++) {
+          if (!sectionMeshes[i].opaqueVertices.empty() || !sectionMeshes[i].waterVertices.empty()) {
+              mesh.sections.push_back(std::move(sectionMeshes[i]));
+          }
+      }
+      std::sort(mesh.sections.begin(), mesh.sections.end(), [](const SectionMesh &a, const SectionMesh &b) {
+          return a.section < b.section;
+      });
+      (*chunkMeshes)[chunkKey] = std::make_shared<const ChunkMesh>(std::move(mesh));
+  }
+
+  // Rebuilt meshes get a new pointer, which is how the renderer knows to upload them again
+  for (size_t i = 0; i < keys.size(); i++) {
+      std::erase_if(meshes[i].sections, [](const SectionMesh &section) {
+          return section.opaqueVertices.empty() && section.waterVertices.empty();
+      });
+      (*chunkMeshes)[keys[i]] = std::make_shared<const ChunkMesh>(std::move(meshes[i]));
+  }
+  m_chunkMeshes = std::move(chunkMeshes);
+  m_addedChunks.clear();
+  m_removedChunks.clear();
+  m_modifiedSections.clear();
+  m_remeshAll = false;
+}
+
+// Turns the block the camera looks at into air.
+void Simulation::breakBlock() {
+  RayHit hit;
+  if (raycast(m_world, cameraPos, cameraFront, reach, hit)) {
+      generator.setBlock(hit.block, airID);
+  }
+}
+
+// Puts a block against the face the camera looks at, unless the player is standing in the way.
+void Simulation::placeBlock() {
+  RayHit hit;
+  if (!raycast(m_world, cameraPos, cameraFront, reach, hit) || hit.normal == glm::ivec3(0)) {
+      return;
+  }
+  glm::ivec3 block = hit.block + hit.normal;
+  glm::vec3 center = TerrainGenerator::getBlockCenter(block.x, block.y, block.z);
+  Box player = getPlayerBox();
+  if (glm::all(glm::lessThan(center - 0.5f, player.max)) && glm::all(glm::greaterThan(center + 0.5f, player.min))) {
+      return;
+  }
+  generator.setBlock(block, placedBlockID);
+}
+
+// Box around the camera the player collides with.
+Box Simulation::getPlayerBox() const {
+  return {cameraPos - glm::vec3(playerRadius, playerRadius, eyeHeight), cameraPos + glm::vec3(playerRadius, playerRadius, headroom)};
+}
+
+// Whether any block the player box overlaps is water.
+bool Simulation::isInWater() const {
+  Box box = getPlayerBox();
+  glm::ivec3 low = WorldView::getBlockAt(box.min);
+  glm::ivec3 high = WorldView::getBlockAt(box.max);
+  for (int x = low.x; x <= high.x; x++) {
+      for (int y = low.y; y <= high.y; y++) {
+          for (int z = low.z; z <= high.z; z++) {
+              if (m_world.getBlock({x, y, z}) == waterID) {
+                  return true;
+              }
+          }
+      }
+  }
+  return false;
+}
+
+// Distance in blocks from the player to the chunk center. Chunks outside a rough view cone come after
+// every chunk in view.
+float Simulation::getChunkPriority(const std::pair<int, int> &chunkKey) const {
+  glm::vec2 toChunk = glm::vec2(chunkKey.first, chunkKey.second) * float(TerrainGenerator::chunkSize) - glm::vec2(cameraPos);
+  glm::vec2 front = glm::vec2(cameraFront);
+  float distance = glm::length(toChunk);
+
+  bool inView = distance < TerrainGenerator::chunkSize || glm::length(front) < 0.01f ||
+                glm::dot(toChunk / distance, glm::normalize(front)) > 0.5f;
+  return inView ? distance : distance + 1000;
+}
+
+void Simulation::publishSnapshot(std::chrono::steady_clock::time_point stepTime) {
+  FrameSnapshot &snapshot = m_snapshots.getWriteBuffer();
+  snapshot.valid = true;
+  snapshot.stepTime = stepTime;
+  snapshot.previousCameraPos = m_previousCameraPos;
+  snapshot.cameraPos = cameraPos;
+  snapshot.cameraFront = cameraFront;
+  snapshot.cameraUp = cameraUp;
+  snapshot.renderDistance = generator.renderDistance;
+  snapshot.lightTypes = lightTypes;
+  snapshot.lightPositions = lightPositions;
+  snapshot.lightDirections = lightDirections;
+  snapshot.attenuationFunctions = attenuationFunctions;
+  snapshot.lightColors = lightColors;
+  snapshot.chunkMeshes = m_chunkMeshes;
+  m_snapshots.publish();
+}
+
+void Simulation::filterTorches(float maxDistance) {
+    FrameVector<size_t> indicesToRemove(&m_frameArena);
+
+    // Find indices to remove
+    for (size_t i = 1; i < lightPositions.size(); ++i) {
+        if (glm::distance(glm::vec3(lightPositions[i]), cameraPos) > maxDistance) {
+            indicesToRemove.push_back(i);
+        }
+    }
+
+    // Sort the indices in reverse order
+    std::sort(indicesToRemove.rbegin(), indicesToRemove.rend());
+
+    // Remove elements from all vectors
+    for (size_t index : indicesToRemove) {
+        lightPositions.erase(lightPositions.begin() + index);
+        attenuationFunctions.erase(attenuationFunctions.begin() + index);
+        lightColors.erase(lightColors.begin() + index);
+        lightDirections.erase(lightDirections.begin() + index);
+        lightTypes.erase(lightTypes.begin() + index);
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "terraingenerator.h"
+#include "chunkmesher.h"
+#include "renderdistancegovernor.h"
+#include "jobsystem.h"
+#include "triplebuffer.h"
+#include "framearena.h"
+#include "worldview.h"
+#include "collision.h"
+
+// Input written by the GUI thread and read by the simulation thread.
+struct InputState {
+    std::atomic<bool> forward{false};
+    std::atomic<bool> back{false};
+    std::atomic<bool> left{false};
+    std::atomic<bool> right{false};
+    std::atomic<bool> jump{false};
+    std::atomic<bool> torch{false};
+    std::atomic<bool> turnLeft{false};
+    std::atomic<bool> turnRight{false};
+    std::atomic<bool> turnUp{false};
+    std::atomic<bool> turnDown{false};
+    std::atomic<int> mouseDeltaX{0};   // drag since the last step, taken by the next one
+    std::atomic<int> mouseDeltaY{0};
+    std::atomic<bool> toggleAmbientOcclusion{false};
+    std::atomic<bool> runBenchmark{false};
+    std::atomic<bool> breakBlock{false}; // clicked since the last step, acts on the block in the middle of the view
+    std::atomic<bool> placeBlock{false};
+};
+
+using ChunkMeshMap = std::map<std::pair<int, int>, std::shared_ptr<const ChunkMesh>>;
+
+// Everything the renderer needs to draw one frame. Published after every step and never changed
+// afterwards, the meshes are shared between snapshots until their chunk is rebuilt.
+struct FrameSnapshot {
+    bool valid = false;
+    std::chrono::steady_clock::time_point stepTime; // when the current state was simulated
+
+    glm::vec3 previousCameraPos;
+    glm::vec3 cameraPos;
+    glm::vec3 cameraFront;
+    glm::vec3 cameraUp;
+    int renderDistance = 0;
+
+    std::vector<int> lightTypes;
+    std::vector<glm::vec4> lightPositions;
+    std::vector<glm::vec4> lightDirections;
+    std::vector<glm::vec3> attenuationFunctions;
+    std::vector<glm::vec3> lightColors;
+
+    std::shared_ptr<const ChunkMeshMap> chunkMeshes; // every loaded chunk, the same map until one of them changes
+};
+
+// Player movement, chunk streaming and meshing, run on their own thread so slow chunk generation
+// never blocks input handling or drawing.
+class Simulation : private ChunkListener
+{
+public:
+    Simulation();
+    ~Simulation();
+
+    // Loads the chunks around the camera, publishes the first snapshot and starts the thread.
+    void start();
+    void stop();
+
+    // GL thread only, returns the newest published snapshot.
+    const FrameSnapshot &acquireSnapshot() { return m_snapshots.acquire(); }
+
+    static constexpr float fixedTimeStep = 1.f / 60.f; // seconds simulated by each step
+    static const int maxStepsPerWake = 15;             // steps caught up on after a stall, the rest are dropped
+
+    InputState input;
+    std::atomic<float> lastFrameTime{0}; // ms, written by the GL thread for the render distance governor
+
+    // Starting camera, only touched by the simulation thread once start() has been called
+    glm::vec3 cameraPos;
+    glm::vec3 cameraFront;
+    glm::vec3 cameraUp;
+
+private:
+    void run();
+    void step(float deltaTime);
+    void chunkAdded(const std::pair<int, int> &chunkKey) override;
+    void chunkRemoved(const std::pair<int, int> &chunkKey) override;
+    void chunkModified(const std::pair<int, int> &chunkKey, int section) override;
+    void updateChunkMeshes();
+    float getChunkPriority(const std::pair<int, int> &chunkKey) const;
+    void breakBlock();
+    void placeBlock();
+    Box getPlayerBox() const;
+    bool isInWater() const;
+    void publishSnapshot(std::chrono::steady_clock::time_point stepTime);
+    void filterTorches(float maxDistance);
+
+    JobSystem m_jobs; // generation and meshing run on its workers, outlives the generator declared after it
+    FrameArena m_frameArena; // lists that only live for one step, reset at the end of each
+    int m_steadySteps = 0;    // steps that loaded and meshed nothing
+    int m_allocatingSteps = 0; // of those, the ones that still went to the heap. Debug builds only
+    TerrainGenerator generator;
+    ChunkMesher m_mesher = ChunkMesher(generator);
+    WorldView m_world = WorldView(generator.getChunkMatrices()); // every gameplay block query goes through it
+    RenderDistanceGovernor m_renderDistanceGovernor;
+    std::shared_ptr<const ChunkMeshMap> m_chunkMeshes = std::make_shared<const ChunkMeshMap>(); // shared with the snapshots
+    std::set<std::pair<int, int>> m_addedChunks;    // reported by the generator since the last updateChunkMeshes
+    std::set<std::pair<int, int>> m_removedChunks;
+    std::set<std::pair<std::pair<int, int>, int>> m_modifiedSections; // chunk and section index
+    bool m_remeshAll = false;    // set when mesher settings change
+    float m_lastStepTime = 0;    // ms spent in the last step
+
+    glm::vec3 m_previousCameraPos;
+    float movementSpeed = 7.f;
+    float m_rotationSpeed = 0.2f;
+    float velocity = 0;
+    float reboundVelocity = 9;
+    float acceleration = -20;
+    float minimumVelocity = -12;
+    bool inTheAir = false;
+    float playerRadius = 0.3f; // half the width of the player box
+    float eyeHeight = 2.5f;    // from the bottom of the player box up to the camera
+    float headroom = 0.25f;    // from the camera up to the top of the player box
+    float stepHeight = 1.f;    // ledges up to this high are climbed without jumping
+    float reach = 6.f;         // furthest from the camera a block can be broken or placed
+    int placedBlockID = 1;     // what placeBlock puts down
+    float swimTimer = 0;
+
+    std::vector<int> lightTypes;
+    std::vector<glm::vec4> lightPositions;
+    std::vector<glm::vec4> lightDirections;
+    std::vector<glm::vec3> attenuationFunctions;
+    std::vector<glm::vec3> lightColors;
+
+    TripleBuffer<FrameSnapshot> m_snapshots;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+};
+
+#endif // SIMULATION_H
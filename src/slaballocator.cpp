@@ -0,0 +1,96 @@
+#include "slaballocator.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <new>
+
+namespace {
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+// Blocks of one size. New slabs are cut into blocks as they are needed rather than all at once.
+struct SizeClass {
+    std::mutex mutex;
+    FreeBlock *free = nullptr;
+    char *next = nullptr; // uncut part of the newest slab
+    char *end = nullptr;
+};
+
+constexpr int classCount = std::bit_width(SlabPool::maxBlockSize / SlabPool::minBlockSize);
+SizeClass sizeClasses[classCount];
+
+std::atomic<size_t> slabs{0};
+std::atomic<size_t> blocksInUse{0};
+std::atomic<size_t> bytesInUse{0};
+std::atomic<size_t> heapAllocations{0};
+
+// 16 bytes and less are class 0, then each class doubles.
+int getClass(size_t bytes) {
+    return std::bit_width((std::max<size_t>(bytes, 1) - 1) / SlabPool::minBlockSize);
+}
+
+}
+
+void *SlabPool::allocate(size_t bytes) {
+    if (bytes > maxBlockSize) {
+        heapAllocations++;
+        return ::operator new(bytes);
+    }
+    int sizeClass = getClass(bytes);
+    size_t blockSize = minBlockSize << sizeClass;
+    blocksInUse++;
+    bytesInUse += blockSize;
+
+    SizeClass &blocks = sizeClasses[sizeClass];
+    std::lock_guard<std::mutex> lock(blocks.mutex);
+    if (blocks.free) {
+        FreeBlock *block = blocks.free;
+        blocks.free = block->next;
+        return block;
+    }
+    if (blocks.next == blocks.end) {
+        // operator new aligns to at least 16 bytes, and every block size is a multiple of that
+        blocks.next = static_cast<char *>(::operator new(slabSize));
+        blocks.end = blocks.next + slabSize;
+        slabs++;
+        heapAllocations++;
+    }
+    void *block = blocks.next;
+    blocks.next += blockSize;
+    return block;
+}
+
+void SlabPool::deallocate(void *pointer, size_t bytes) {
+    if (bytes > maxBlockSize) {
+        ::operator delete(pointer);
+        return;
+    }
+    int sizeClass = getClass(bytes);
+    blocksInUse--;
+    bytesInUse -= minBlockSize << sizeClass;
+
+    SizeClass &blocks = sizeClasses[sizeClass];
+    std::lock_guard<std::mutex> lock(blocks.mutex);
+    FreeBlock *block = static_cast<FreeBlock *>(pointer);
+    block->next = blocks.free;
+    blocks.free = block;
+}
+
+size_t SlabPool::getBlockSize(size_t bytes) {
+    if (bytes == 0 || bytes > maxBlockSize) {
+        return bytes;
+    }
+    return minBlockSize << getClass(bytes);
+}
+
+SlabPool::Stats SlabPool::getStats() {
+    Stats stats;
+    stats.slabs = slabs;
+    stats.blocksInUse = blocksInUse;
+    stats.bytesInUse = bytesInUse;
+    stats.heapAllocations = heapAllocations;
+    return stats;
+}
@@ -0,0 +1,49 @@
+#ifndef SLABALLOCATOR_H
+#define SLABALLOCATOR_H
+#include <cstddef>
+
+// Memory for chunk data in fixed size blocks of 16 to 1024 bytes, cut from 16 KB slabs. A freed block
+// goes on the free list of its size and is handed out again before a new slab is taken, so once the
+// loaded world stops growing, generating and unloading chunks no longer touches the global heap.
+// Slabs are kept until the program ends, memory stays at the most the world ever needed. Requests
+// larger than a block go to the global heap. Safe to use from any thread.
+class SlabPool
+{
+public:
+    static constexpr size_t slabSize = 16 * 1024;
+    static constexpr size_t minBlockSize = 16;
+    static constexpr size_t maxBlockSize = 1024;
+
+    static void *allocate(size_t bytes);
+    static void deallocate(void *pointer, size_t bytes);
+    // Bytes a request of that size takes, 0 for 0.
+    static size_t getBlockSize(size_t bytes);
+
+    struct Stats {
+        size_t slabs = 0;
+        size_t blocksInUse = 0;
+        size_t bytesInUse = 0;      // rounded up to the block sizes
+        size_t heapAllocations = 0; // slabs plus requests too large for a block, since the start
+    };
+    static Stats getStats();
+};
+
+// Standard allocator over SlabPool, for the containers and shared pointers holding chunk data.
+template<typename T>
+struct SlabAllocator
+{
+    using value_type = T;
+    static_assert(alignof(T) <= SlabPool::minBlockSize, "blocks are aligned to their smallest size");
+
+    SlabAllocator() = default;
+    template<typename U>
+    SlabAllocator(const SlabAllocator<U> &) {}
+
+    T *allocate(size_t count) { return static_cast<T *>(SlabPool::allocate(count * sizeof(T))); }
+    void deallocate(T *pointer, size_t count) { SlabPool::deallocate(pointer, count * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const SlabAllocator<U> &) const { return true; }
+};
+
+#endif // SLABALLOCATOR_H
@@ -2,11 +2,21 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "FastNoiseLite.h"  // Include FastNoiseLite
-#include "src/cube.h"
+#include "jobsystem.h"
+#include "worldview.h"
 #include <random>
+#include <cmath>
+#include <algorithm>
 #include <iostream>
 
-TerrainGenerator::TerrainGenerator(){
+TerrainGenerator::TerrainGenerator()
+    : worldSeed(std::random_device{}())
+{
+}
+
+TerrainGenerator::~TerrainGenerator(){
+    // Generation jobs call back into this object, so stop them and wait for them before it goes away.
+    cancelPendingChunks();
 }
 
 // Add this method to TerrainGenerator class
@@ -28,17 +38,14 @@ float TerrainGenerator::getFractalNoise(FastNoiseLite noise, float x, float y, i
 }
 
 
-void generateTree(int baseX, int baseY, int baseZ, std::map<std::tuple<int,int,int>, Cube*> &matricesCubes,
-                  int originalX, int originalY, int originalZ) {
-    int treeHeight = rand() % 5 + 4; // Random tree height between 4 and 8
-    int leafRadius = 2; // Radius of the leaves around the top
+const int leafRadius = 2; // Radius of the leaves around the top of a tree
+
+void generateTree(ChunkBlocks &blocks, int originalX, int originalY, int originalZ, std::mt19937 &random) {
+    int treeHeight = random() % 5 + 4; // Random tree height between 4 and 8
 
     // Make trunk
-    for (int z = (baseZ); z < baseZ + treeHeight; ++z) {
-        glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(baseX, baseY, z));
-        Cube* newCube = new Cube(translation);
-        newCube->setID(2);
-        matricesCubes[{originalX, originalY, z - baseZ + originalZ}] = newCube;
+    for (int z = 0; z < treeHeight; ++z) {
+        blocks.set(originalX, originalY, originalZ + z, 2);
     }
 
     // Generate leaves
@@ -46,10 +53,7 @@ void generateTree(int baseX, int baseY, int baseZ, std::map<std::tuple<int,int,i
         for (int y = -leafRadius; y <= leafRadius; ++y) {
             for (int z = treeHeight - leafRadius; z <= treeHeight; ++z) {
                 if (x * x + y * y + (z - treeHeight + leafRadius) * (z - treeHeight + leafRadius) <= leafRadius * leafRadius) {
-                    glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(baseX + x, baseY + y, baseZ + z));
-                    Cube* newCube = new Cube(translation);
-                    newCube->setID(3);
-                    matricesCubes[{originalX + x, originalY + y, baseZ + z}] = newCube;
+                    blocks.set(originalX + x, originalY + y, originalZ + z, 3);
                 }
             }
         }
@@ -58,8 +62,8 @@ void generateTree(int baseX, int baseY, int baseZ, std::map<std::tuple<int,int,i
 
 
 // Function takes in the current chunk location (using ints) and using these as offsets.
-std::map<std::tuple<int, int, int>, Cube*> TerrainGenerator::createTranslationMatricesForChunk(int chunkX, int chunkY) {
-    std::map<std::tuple<int, int, int>, Cube*> matricesCubes;
+ChunkBlocks TerrainGenerator::createTranslationMatricesForChunk(int chunkX, int chunkY, int heightOffset, const std::atomic<int> *state) {
+    ChunkBlocks blocks(worldHeight);
 
     // Use FastNoiseLite library.
     FastNoiseLite noise;
@@ -68,230 +72,365 @@ std::map<std::tuple<int, int, int>, Cube*> TerrainGenerator::createTranslationMa
     noise.SetFrequency(0.02f); // Can change this to get more mountainous terrain.
 
     // Want to center the chunk around the players current location.
-    float centerXOffset = chunkSize / 2.0f;
-    float centerYOffset = chunkSize / 2.0f;
     float centerZOffset = maxChunkHeight / 2.0f;
 
-    // Based on what chunk we are in we need to offset from the origin using the values of chunkX and chunkY.
-    float worldXOffset = chunkX * chunkSize;
-    float worldYOffset = chunkY * chunkSize;
-
-    std::default_random_engine generator;
+    // Seeded from the chunk position so the same chunk always comes out the same.
+    std::seed_seq seed{worldSeed, static_cast<unsigned>(chunkX), static_cast<unsigned>(chunkY)};
+    std::mt19937 random(seed);
     std::uniform_real_distribution<float> distribution(0.0, 1.0);
-    int terrainOffset = getRandomInt();
 
     // Iterate through the block in the chunk.
     for (int x = 0; x < chunkSize; x++) {
+        // The player moved away, whatever was built so far is thrown away by the caller.
+        if (state && *state == ChunkJob::cancelled) {
+            break;
+        }
         for (int y = 0; y < chunkSize; y++) {
 
 
 
             // Use noise to get the height of terrain.
             float heightValue = noise.GetNoise((float)x + chunkX * chunkSize, (float)y + chunkY * chunkSize);
-            int terrainHeight = static_cast<int>((heightValue + 1) * 0.5 * maxChunkHeight)+previousHeightOFfset;
+            int terrainHeight = static_cast<int>((heightValue + 1) * 0.5 * maxChunkHeight)+heightOffset;
 
             // Iterate through the depth of the terrain and create blocks up until the terrain height.
             for (int z = 0; z < chunkDepth; z++) {
 
-                // use the calculated offsets from earlier to form the translation matrix of the given cube.
-                // z is offset by negative maxChunkHeight so that the blocks form beneath us.
-                glm::mat4 translation = glm::translate(glm::mat4(1.0f), glm::vec3(
-                                                                            x - centerXOffset + worldXOffset,
-                                                                            y - centerYOffset + worldYOffset,
-                                                                            -maxChunkHeight + z - centerZOffset));
-
                 // Basic terrain.
                 if (z < terrainHeight) {
-                    matricesCubes[{x,y,z}] = new Cube(translation);
+                    blocks.set(x, y, z, random() % 2);
                 }
 
                 // Add a layer of water.
                 if (z <= chunkDepth - 14) {
                     if (z > terrainHeight-1) {
-                        Cube* cube = new Cube(translation);
-                        cube->setID(5);
-                        matricesCubes[{x,y,z}] = cube;
+                        blocks.set(x, y, z, 5);
                     }
                 }
 
                 if (z == terrainHeight){
                     // Generate random probability of creating a tree and calculate the x,y, and z values for the tree.
-                    float chance = distribution(generator);
+                    float chance = distribution(random);
+                    // z is offset by negative maxChunkHeight so that the blocks form beneath us.
                     float currHeight = -maxChunkHeight + z - centerZOffset-1;
-                    float currX =  x - centerXOffset + worldXOffset;
-                    float currY = y - centerYOffset + worldYOffset;
+
+                    // Keep the leaves inside this chunk so every block is keyed by a valid local index.
+                    bool fitsInChunk = x >= leafRadius && x < chunkSize - leafRadius &&
+                                       y >= leafRadius && y < chunkSize - leafRadius;
 
                     // If height and probability match characteristics generate tree.
-                    if (chance < treeProbability && currHeight > treeHeight){
-                        generateTree(currX, currY, currHeight, matricesCubes, x, y, z); // Generate the tree
+                    if (chance < treeProbability && currHeight > treeHeight && fitsInChunk){
+                        generateTree(blocks, x, y, z, random); // Generate the tree
                     }
-                    matricesCubes[{x,y,z}] = new Cube(translation);
+                    blocks.set(x, y, z, random() % 2);
                 }
             }
         }
     }
-//    if(counter >= 7 || previousHeightOFfset >= 7){
-//        previousHeightOFfset-=getRandomInt();
-//    }
-//    else{
-//        previousHeightOFfset+=getRandomInt();
-//    }
-//    if(counter >=10){
-//        counter = 0;
-//    }
-//    else{
-//        counter+=1;
-//    }
-
-    return matricesCubes;
+    blocks.shareUniformSections();
+    return blocks;
+}
+
+// index of the chunk containing the given world x or y coordinate; chunks are centered on multiples of chunkSize.
+int TerrainGenerator::getChunkIndex(float coordinate) {
+    return static_cast<int>(floor((coordinate + chunkSize / 2.f) / (chunkSize * offset)));
 }
 
 // based on the current camera position and render distance loads and unloads chunks
 bool TerrainGenerator::checkAndLoadChunks() {
-    // Adjust position for the fact that the original chunk is centered on the player.
-    float adjustedPositionX = playerPosition.x + (playerPosition.x / abs(playerPosition.x)) * (float) chunkSize / 2.f;
-    float adjustedPositionY = playerPosition.y + (playerPosition.y / abs(playerPosition.y)) * (float) chunkSize / 2.f;
+    renderDistance = std::min(renderDistance, maxRenderDistance);
 
     // Index of the current chunk that the player is in.
-    int currentChunkX = static_cast<int>(adjustedPositionX / (chunkSize * offset));
-    int currentChunkY = static_cast<int>(adjustedPositionY / (chunkSize * offset));
-
-    // Create a list to keep track of chunks to unload
-    std::vector<std::pair<int, int>> chunksToUnload;
-
-    // Iterate through all loaded chunks
-    for (auto& chunk : chunkMatrices1) {
-        int x = chunk.first.first;
-        int y = chunk.first.second;
-
-        // Check if the chunk is outside the render distance
-        if (x < currentChunkX - renderDistance || x > currentChunkX + renderDistance ||
-            y < currentChunkY - renderDistance || y > currentChunkY + renderDistance) {
-            // Mark this chunk for removal
-            chunksToUnload.push_back(chunk.first);
+    int currentChunkX = getChunkIndex(playerPosition.x);
+    int currentChunkY = getChunkIndex(playerPosition.y);
+
+    // The sets of loaded and wanted chunks only change when the window moves or resizes.
+    std::pair<int, int> prefetch = getPrefetchOffset();
+    std::tuple<int, int, int, int, int> window = {currentChunkX, currentChunkY, renderDistance, prefetch.first, prefetch.second};
+    bool windowMoved = window != lastWindow;
+    auto [lastChunkX, lastChunkY, lastDistance, lastPrefetchX, lastPrefetchY] = lastWindow;
+    lastWindow = window;
+
+    // Every loaded chunk was wanted by the last window, in its render window or the prefetch window
+    // beside it. So only the parts of those two outside the new render window can hold chunks to unload,
+    // the rows and columns the window moved off plus the prefetch edge.
+    FrameVector<std::pair<int, int>> chunksToUnload(frameArena);
+    for (int square = 0; windowMoved && square < 2; square++) {
+        int centerX = lastChunkX + (square ? lastPrefetchX : 0);
+        int centerY = lastChunkY + (square ? lastPrefetchY : 0);
+        for (int x = centerX - lastDistance; x <= centerX + lastDistance; x++) {
+            bool inRenderColumns = std::abs(x - currentChunkX) <= renderDistance;
+            for (int y = centerY - lastDistance; y <= centerY + lastDistance; y++) {
+                if (inRenderColumns && std::abs(y - currentChunkY) <= renderDistance) {
+                    y = currentChunkY + renderDistance; // still in the render window up to there
+                    continue;
+                }
+                // the prefetch window overlaps the render window, visit those chunks once
+                bool visited = square == 1 && std::abs(x - lastChunkX) <= lastDistance && std::abs(y - lastChunkY) <= lastDistance;
+                if (!visited && chunkMatrices1.contains({x, y}) && !isWanted({x, y})) {
+                    chunksToUnload.push_back({x, y});
+                }
+            }
         }
     }
 
     for (auto& chunk : chunksToUnload) {
-        cachedChunkMatrices2[chunk] = chunkMatrices1[chunk];
-        chunkMatrices1.erase(chunk);
+        ChunkBlocks blocks = unloadChunk(chunk);
+        blocks.shareUniformSections(); // edits can leave sections uniform
+        cachedChunkMatrices2.put(chunk, std::move(blocks), modifiedChunks.erase(chunk) > 0);
     }
 
-    if(counter % 20 == 0){
-    int randomInt = getRandomInt();
-    if(randomInt != 0 && randomInt != 1 && randomInt != -1){
-        previousHeightOFfset++;
-    }
-    else{
-        if(previousHeightOFfset <= 1){
-            previousHeightOFfset = randomInt;
+    // Drop chunks still being generated that are no longer wanted. Queued jobs return as soon
+    // as they start and running ones stop at the next column.
+    for (auto it = pendingChunks.begin(); windowMoved && it != pendingChunks.end();) {
+        if (isWanted(it->first)) {
+            ++it;
+            continue;
         }
-        else{
-            previousHeightOFfset--;
+        it->second.chunk->state = ChunkJob::cancelled;
+        cancelledJobs.push_back(std::move(it->second.job));
+        chunksCancelled++;
+        it = pendingChunks.erase(it);
+    }
+    std::erase_if(cancelledJobs, JobSystem::isFinished);
+
+    // Pick up the chunks whose jobs have finished since the last call
+    bool loadedChunk = false;
+    for (auto it = pendingChunks.begin(); it != pendingChunks.end();) {
+        if (it->second.chunk->state != ChunkJob::generated) {
+            ++it;
+            continue;
         }
-
+        loadChunk(it->first, std::move(it->second.chunk->blocks));
+        it = pendingChunks.erase(it);
+        loadedChunk = true;
     }
 
+    // Find the chunks missing from the render and prefetch windows, nearest and most in the way first, so
+    // growing the render distance streams the new ring in over several calls instead of generating it all in one tick.
+    // Skipped while the window stays put and everything in it is already loaded.
+    FrameVector<std::pair<int, int>> missingChunks(frameArena);
+    int scanWidth = (windowMoved || chunkBacklog > 0) ? renderDistance : -1;
+    for (int x = currentChunkX - scanWidth + std::min(prefetch.first, 0); x <= currentChunkX + scanWidth + std::max(prefetch.first, 0); ++x) {
+        for (int y = currentChunkY - scanWidth + std::min(prefetch.second, 0); y <= currentChunkY + scanWidth + std::max(prefetch.second, 0); ++y) {
+            if (isWanted({x, y}) && !chunkMatrices1.contains({x, y}) && pendingChunks.find({x, y}) == pendingChunks.end()) {
+                missingChunks.push_back({x, y});
+            }
+        }
     }
-    counter++;
-    for (int x = currentChunkX - renderDistance; x <= currentChunkX + renderDistance; ++x) {
-        for (int y = currentChunkY - renderDistance; y <= currentChunkY + renderDistance; ++y) {
-            std::pair<int, int> chunkKey = {x, y};
-            if (chunkMatrices1.find(chunkKey) == chunkMatrices1.end()) {
-                // Check cache first
-                if (cachedChunkMatrices2.find(chunkKey) != cachedChunkMatrices2.end()) {
-                    // Load from cache
-                    chunkMatrices1[chunkKey] = cachedChunkMatrices2[chunkKey];
-                    cachedChunkMatrices2.erase(chunkKey);
-                } else {
-                    // Generate new chunk
-                    chunkMatrices1[chunkKey] = createTranslationMatricesForChunk(x, y);
-                }
+    std::sort(missingChunks.begin(), missingChunks.end(), [&](const auto &a, const auto &b) {
+        return getLoadPriority(a) < getLoadPriority(b);
+    });
+
+    // Chunks already being generated count against the limit so a backlog of jobs cannot build up.
+    FrameVector<std::pair<int, int>> chunksToGenerate(frameArena);
+    size_t generateLimit = maxChunksPerUpdate * (jobs ? jobs->getWorkerCount() : 1);
+    size_t inFlight = pendingChunks.size();
+    chunkBacklog = 0;
+    for (const auto &chunkKey : missingChunks) {
+        // Check cache first
+        ChunkBlocks cached;
+        bool modified;
+        if (cachedChunkMatrices2.take(chunkKey, cached, modified)) {
+            // Load from cache
+            if (modified) {
+                modifiedChunks.insert(chunkKey);
             }
+            loadChunk(chunkKey, std::move(cached));
+            loadedChunk = true;
+        } else if (inFlight + chunksToGenerate.size() < generateLimit) {
+            // Generate new chunk
+            chunksToGenerate.push_back(chunkKey);
+        } else {
+            chunkBacklog++;
         }
     }
-    return !chunksToUnload.empty();
+    if (generateChunks(chunksToGenerate)) {
+        loadedChunk = true;
+    }
+    chunkBacklog += pendingChunks.size();
+    return loadedChunk || !chunksToUnload.empty();
 }
 
-// takes in player position (cameraPosition instance variable) and updates chunks based on that
-std::vector<Cube*> TerrainGenerator::updatePlayerPosition(const glm::vec3& newPosition, std::vector<Cube*> oldCubes, bool isFirst) {
-    playerPosition = newPosition;
+bool TerrainGenerator::isInRenderWindow(const std::pair<int, int> &chunkKey) const {
+    int currentChunkX = getChunkIndex(playerPosition.x);
+    int currentChunkY = getChunkIndex(playerPosition.y);
+    return std::abs(chunkKey.first - currentChunkX) <= renderDistance && std::abs(chunkKey.second - currentChunkY) <= renderDistance;
+}
 
-    std::vector<Cube*> cubesVector = oldCubes;
-    // should return true or false
-    if(checkAndLoadChunks() || isFirst){
-        cubesVector.clear();
-        for (const auto& chunkEntry : chunkMatrices1) {
-            const auto& chunkMatrix = chunkEntry.second;
+// in the render window, or in the same size window moved ahead along the player's movement.
+bool TerrainGenerator::isWanted(const std::pair<int, int> &chunkKey) const {
+    std::pair<int, int> prefetch = getPrefetchOffset();
+    return isInRenderWindow(chunkKey) || isInRenderWindow({chunkKey.first - prefetch.first, chunkKey.second - prefetch.second});
+}
 
-            for (const auto& cubeIndex : chunkMatrix) {
-                const auto& cube = cubeIndex.second;
-                cubesVector.push_back(cube);
-            }
-        }
+// how many chunks the player is expected to move in prefetchUpdates updates, at most maxPrefetchChunks.
+std::pair<int, int> TerrainGenerator::getPrefetchOffset() const {
+    glm::vec2 ahead = playerVelocity * prefetchUpdates / float(chunkSize);
+    if (glm::length(ahead) > maxPrefetchChunks) {
+        ahead = glm::normalize(ahead) * float(maxPrefetchChunks);
     }
-    return cubesVector;
+    return {static_cast<int>(std::round(ahead.x)), static_cast<int>(std::round(ahead.y))};
 }
 
-// finds the z value of the block underneath the camera position passed in.
-int TerrainGenerator::getGroundHeight(glm::vec3 position) {
-    // Adjust position for the fact that the original chunk is centered on the player.
-    float adjustedPositionX = position.x + (position.x / abs(position.x)) * (float) chunkSize / 2.f;
-    float adjustedPositionY = position.y + (position.y / abs(position.y)) * (float) chunkSize / 2.f;
+// distance in chunks from the player, less up to directionBias for chunks along the movement or look
+// direction. Prefetched chunks outside the render window come after every chunk inside it.
+float TerrainGenerator::getLoadPriority(const std::pair<int, int> &chunkKey) const {
+    glm::vec2 toChunk = glm::vec2(chunkKey.first - getChunkIndex(playerPosition.x), chunkKey.second - getChunkIndex(playerPosition.y));
+    float distance = glm::length(toChunk);
 
-    // Index of the current chunk that the player is in.
-    int currentChunkX = static_cast<int>(adjustedPositionX / (chunkSize * offset));
-    int currentChunkY = static_cast<int>(adjustedPositionY / (chunkSize * offset));
-
-    // Value of X and Y, anywhere from 0 -> chunkSize, within the chunk.
-    int chunkX = (int) position.x - chunkSize * currentChunkX + chunkSize / 2;
-    int chunkY = (int) position.y - chunkSize * currentChunkY + chunkSize / 2;
-
-    // Offset by -1 if it's in a negative chunk so value starts at 0.
-    chunkX = (currentChunkX < 0) ? chunkX - 1 : chunkX;
-    chunkY = (currentChunkY < 0) ? chunkY - 1 : chunkY;
-
-    // Check the block above and below the Z position.
-    bool inWater = false;
-    for (int i = -1; i <= 1; i++) {
-        int chunkZ = floor(position.z - 0.5) + i + chunkDepth + chunkDepth / 2;
-        // If any of the blocks are filled, return false.
-        if (chunkMatrices1[{currentChunkX, currentChunkY}].find({chunkX, chunkY, chunkZ}) !=
-            chunkMatrices1[{currentChunkX, currentChunkY}].end()) {
-            int id = chunkMatrices1[{currentChunkX, currentChunkY}][{chunkX, chunkY, chunkZ}]->getID();
-            if (id != 5) {
-                return 0;
-            } else inWater = true;
+    float alignment = 0;
+    glm::vec2 look = glm::vec2(lookDirection);
+    if (distance > 0 && glm::length(playerVelocity) > 0.001f) {
+        alignment = std::max(alignment, glm::dot(toChunk / distance, glm::normalize(playerVelocity)));
+    }
+    if (distance > 0 && glm::length(look) > 0.001f) {
+        alignment = std::max(alignment, glm::dot(toChunk / distance, glm::normalize(look)));
+    }
+
+    float priority = distance - directionBias * alignment;
+    return isInRenderWindow(chunkKey) ? priority : priority + 1000;
+}
+
+// generates the given chunks, nearest first. Without a job system they are added right away and true is returned.
+// Otherwise each chunk becomes a background job and is added by a later checkAndLoadChunks once it has finished.
+bool TerrainGenerator::generateChunks(std::span<const std::pair<int, int>> chunkKeys) {
+    if (jobs == nullptr) {
+        for (const auto &chunkKey : chunkKeys) {
+            loadChunk(chunkKey, createTranslationMatricesForChunk(chunkKey.first, chunkKey.second, getHeightOffset(chunkKey)));
         }
+        return !chunkKeys.empty();
+    }
+
+    for (const auto &chunkKey : chunkKeys) {
+        auto chunk = std::make_shared<ChunkJob>();
+        int heightOffset = getHeightOffset(chunkKey); // read here, the job must not touch state the simulation changes
+        JobHandle job = jobs->submit([this, chunk, chunkKey, heightOffset] {
+            // A cancelled job may run after the generator is gone, so it must not touch it
+            if (chunk->state == ChunkJob::cancelled) {
+                return;
+            }
+            chunk->blocks = createTranslationMatricesForChunk(chunkKey.first, chunkKey.second, heightOffset, &chunk->state);
+            int generating = ChunkJob::generating;
+            chunk->state.compare_exchange_strong(generating, ChunkJob::generated);
+        }, getLoadPriority(chunkKey) * chunkSize);
+        pendingChunks[chunkKey] = {job, chunk};
     }
-    return (inWater) ? 2 : 1;
+    return false;
 }
 
-// getter method for chunk data.
-const std::map<std::pair<int, int>, std::map<std::tuple<int, int, int>, Cube*>>& TerrainGenerator::getChunkMatrices() const {
-    return chunkMatrices1;
+// adds the chunk to chunkMatrices1 and tells the listener.
+void TerrainGenerator::loadChunk(const std::pair<int, int> &chunkKey, ChunkBlocks blocks) {
+    loadedBytes += blocks.getBytes();
+    chunkMatrices1.insert(chunkKey, std::move(blocks));
+    if (listener) {
+        listener->chunkAdded(chunkKey);
+    }
+}
+
+// takes the chunk out of chunkMatrices1 and tells the listener.
+ChunkBlocks TerrainGenerator::unloadChunk(const std::pair<int, int> &chunkKey) {
+    ChunkBlocks blocks = chunkMatrices1.take(chunkKey);
+    loadedBytes -= blocks.getBytes();
+    if (listener) {
+        listener->chunkRemoved(chunkKey);
+    }
+    return blocks;
+}
+
+void TerrainGenerator::waitForPendingChunks() {
+    for (const auto &pending : pendingChunks) {
+        jobs->wait(pending.second.job);
+    }
+}
+
+void TerrainGenerator::cancelPendingChunks() {
+    for (auto &pending : pendingChunks) {
+        pending.second.chunk->state = ChunkJob::cancelled;
+        cancelledJobs.push_back(std::move(pending.second.job));
+    }
+    pendingChunks.clear();
+    for (const JobHandle &job : cancelledJobs) {
+        jobs->wait(job);
+    }
+    cancelledJobs.clear();
+}
+
+// height offset a chunk is generated with, -2 to 2. Low frequency noise over the chunk grid seeded from the
+// world, so the terrain still drifts up and down slowly across chunks and a chunk evicted from the cache
+// comes out the same when it is generated again.
+int TerrainGenerator::getHeightOffset(const std::pair<int, int> &chunkKey) const {
+    FastNoiseLite noise(worldSeed);
+    noise.SetNoiseType(FastNoiseLite::NoiseType_Perlin);
+    noise.SetFrequency(0.05f);
+    return static_cast<int>(std::round(noise.GetNoise(float(chunkKey.first), float(chunkKey.second)) * 2));
 }
 
-int TerrainGenerator::getRandomInt() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+// takes in player position (cameraPosition instance variable) and updates chunks based on that.
+// Returns true if any chunk was loaded or unloaded.
+bool TerrainGenerator::updatePlayerPosition(const glm::vec3& newPosition) {
+    playerVelocity = 0.8f * playerVelocity + 0.2f * glm::vec2(newPosition - playerPosition);
+    playerPosition = newPosition;
+    return checkAndLoadChunks();
+}
 
-    // Set up a discrete distribution where 0 has a 90% probability,
-    // and -1, 1, 2, 3 each have a 2.5% probability
-    std::discrete_distribution<> dis({50, 20, 20, 5, 5});
+// returns the id of the block at the given world block coordinate, or -1 for air and unloaded chunks.
+int TerrainGenerator::getBlockID(int worldX, int worldY, int z) const {
+    return WorldView(chunkMatrices1).getBlock({worldX, worldY, z});
+}
 
-    // Generate a number based on the distribution
-    int number = dis(gen);
+// whether the block at the given world block coordinate is solid, false for unloaded chunks.
+bool TerrainGenerator::isSolid(int worldX, int worldY, int z) const {
+    return WorldView(chunkMatrices1).isSolid({worldX, worldY, z});
+}
 
-    // Map the generated number to the desired range and return it
-    if (number == 0) {
-        return 0;  // 50% chance
-    } else if (number == 1) {
-        return -1; // 20% chance
-    } else {
-        return number - 1; // 20% chance for 1, 5% each for 2 and 3
+// sets the block at the given world block coordinate and tells the listener about every loaded section
+// whose mesh it changes.
+bool TerrainGenerator::setBlock(glm::ivec3 block, int id) {
+    ChunkBlocks *chunk = chunkMatrices1.find(WorldView::getChunkKey(block));
+    if (chunk == nullptr || block.z < 0 || block.z >= chunk->getHeight()) {
+        return false;
+    }
+    if (chunk->get(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z) == id) {
+        return true;
+    }
+    loadedBytes -= chunk->getBytes();
+    chunk->set(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z, id);
+    loadedBytes += chunk->getBytes();
+    modifiedChunks.insert(WorldView::getChunkKey(block));
+
+    // The faces and ambient occlusion of every block touching this one change too, so a block on a
+    // section or chunk boundary also dirties the sections across it, diagonal ones included
+    if (listener) {
+        auto [lowX, lowY] = WorldView::getChunkKey(block - 1);
+        auto [highX, highY] = WorldView::getChunkKey(block + 1);
+        int lowSection = std::max(block.z - 1, 0) / ChunkColumn::sectionHeight;
+        int highSection = (block.z + 1) / ChunkColumn::sectionHeight;
+        for (int chunkX = lowX; chunkX <= highX; chunkX++) {
+            for (int chunkY = lowY; chunkY <= highY; chunkY++) {
+                if (!chunkMatrices1.contains({chunkX, chunkY})) {
+                    continue;
+                }
+                for (int section = lowSection; section <= highSection; section++) {
+                    listener->chunkModified({chunkX, chunkY}, section);
+                }
+            }
+        }
     }
+    return true;
+}
 
+// center of the block at the given world block coordinate, matching the translations built in createTranslationMatricesForChunk.
+glm::vec3 TerrainGenerator::getBlockCenter(int worldX, int worldY, int z) {
+    return glm::vec3(worldX - chunkSize / 2.0f, worldY - chunkSize / 2.0f, z - maxChunkHeight - maxChunkHeight / 2.0f);
+}
 
+// rough memory held by the loaded chunks, kept as a running total so the governor can read it every step.
+size_t TerrainGenerator::getLoadedBytes() const {
+    return loadedBytes;
 }
 
+// getter method for chunk data.
+const ChunkGrid& TerrainGenerator::getChunkMatrices() const {
+    return chunkMatrices1;
+}
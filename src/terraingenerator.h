@@ -1,46 +1,110 @@
 #ifndef TERRAINGENERATOR_H
 #define TERRAINGENERATOR_H
-#include "src/cube.h"
 #include <vector>
 #include <glm/glm.hpp>
 #include <map>
-#include "cube.h"
+#include <set>
+#include <span>
 #include "FastNoiseLite.h"
+#include "jobsystem.h"
+#include "chunkgrid.h"
+#include "chunkcache.h"
+#include "framearena.h"
+
+// Told about every change to the loaded chunks, in the order they happen, on the thread updating the generator.
+class ChunkListener
+{
+public:
+    virtual ~ChunkListener() = default;
+    virtual void chunkAdded(const std::pair<int, int> &chunkKey) = 0;
+    virtual void chunkRemoved(const std::pair<int, int> &chunkKey) = 0;
+    // Blocks of a loaded chunk changed in a way that changes the mesh of the given section.
+    virtual void chunkModified(const std::pair<int, int> &chunkKey, int section) = 0;
+};
 
 class TerrainGenerator
 {
 public:
     TerrainGenerator();
-    std::map<std::tuple<int, int, int>, Cube*> createTranslationMatricesForChunk(int chunkX, int chunkY);
+    ~TerrainGenerator();
+
+    // A chunk being generated on the job system. The job sets the state to generated once the blocks are
+    // filled in, the generator sets it to cancelled to make the job stop early.
+    struct ChunkJob {
+        enum State { generating, generated, cancelled };
+        std::atomic<int> state{generating};
+        ChunkBlocks blocks;
+    };
+    struct PendingChunk {
+        JobHandle job;
+        std::shared_ptr<ChunkJob> chunk;
+    };
+
+    // Stops early and returns what it has when the state is set to cancelled.
+    ChunkBlocks createTranslationMatricesForChunk(int chunkX, int chunkY, int heightOffset, const std::atomic<int> *state = nullptr);
     static float getOffset();
     static const int chunkSize = 8;
+    static_assert(chunkSize == ChunkColumn::sectionWidth, "chunks are one section wide");
     static const int maxChunkHeight = 25;
     static const int chunkDepth  = 25;
     static const int offset = 1;
     float treeProbability = 0.15; // probability of generating a tree above grass (1% -> happens once in every 100 blocks generated)
     float treeHeight = -24; // generates trees above z_values > -15
 
-    int previousHeightOFfset = 0;
+    int worldHeight = 256; // blocks per column, sections above the terrain take no memory. Set before generating.
+
+    unsigned worldSeed; // with the chunk position seeds everything random about a chunk
+    int getHeightOffset(const std::pair<int, int> &chunkKey) const;
 
     float getFractalNoise(FastNoiseLite noise, float x, float y, int octaves, float persistence);
 
-    glm::vec3 playerPosition;
-    int renderDistance = 2; // Number of chunks to render in each direction from the player
-    std::vector<Cube*> updatePlayerPosition(const glm::vec3& newPosition, std::vector<Cube*> oldCubes, bool isFirst);
+    glm::vec3 playerPosition = glm::vec3(0);
+    glm::vec2 playerVelocity = glm::vec2(0); // Smoothed horizontal movement per update, derived from playerPosition
+    glm::vec3 lookDirection = glm::vec3(0);  // Set by the caller, chunks along it are loaded first
+    float prefetchUpdates = 60;   // How many updates ahead of the player chunks are prefetched along its movement
+    int maxPrefetchChunks = 2;    // Furthest the prefetch window is moved ahead of the render window, at most 2
+    float directionBias = 1.5f;   // Chunks straight along the movement or look direction count as this many chunks closer
+    int renderDistance = 2; // Number of chunks to render in each direction from the player, adjusted by RenderDistanceGovernor
+    static constexpr int maxRenderDistance = (ChunkGrid::width - 1) / 2 - 2; // leaves room in the grid for maxPrefetchChunks
+    int maxChunksPerUpdate = 2; // New chunks generated per checkAndLoadChunks call, the rest wait for later calls
+    int chunkBacklog = 0; // Chunks inside the render or prefetch window still waiting to be generated
+    JobSystem *jobs = nullptr; // When set new chunks are generated in the background, maxChunksPerUpdate per worker
+    FrameArena *frameArena = nullptr; // When set the lists built by each update come from it instead of the heap
+    ChunkListener *listener = nullptr; // When set told about every chunk loaded into or unloaded from chunkMatrices1 and every block set
+    std::map<std::pair<int, int>, PendingChunk> pendingChunks; // chunks whose generation job has not been collected yet
+    std::vector<JobHandle> cancelledJobs; // jobs of dropped pending chunks that may not have run yet
+    int chunksCancelled = 0;  // pending chunks dropped because the player moved away before they were needed
+    bool updatePlayerPosition(const glm::vec3& newPosition);
     bool checkAndLoadChunks();
-    const std::map<std::pair<int, int>, std::map<std::tuple<int, int, int>, Cube*>>& getChunkMatrices() const;
-
-    std::map<std::pair<int, int>, std::map<std::tuple<int, int, int>, Cube*>> chunkMatrices1;
-    std::map<std::pair<int, int>, std::map<std::tuple<int, int, int>, Cube*>> cachedChunkMatrices2;
+    bool generateChunks(std::span<const std::pair<int, int>> chunkKeys);
+    void loadChunk(const std::pair<int, int> &chunkKey, ChunkBlocks blocks);
+    ChunkBlocks unloadChunk(const std::pair<int, int> &chunkKey);
+    void waitForPendingChunks();
+    // Cancels every generation job and waits until none of them can touch the generator any more.
+    void cancelPendingChunks();
+    static int getChunkIndex(float coordinate);
+    bool isInRenderWindow(const std::pair<int, int> &chunkKey) const;
+    bool isWanted(const std::pair<int, int> &chunkKey) const;
+    std::pair<int, int> getPrefetchOffset() const;
+    float getLoadPriority(const std::pair<int, int> &chunkKey) const;
+    size_t getLoadedBytes() const;
+    const ChunkGrid& getChunkMatrices() const;
+    size_t loadedBytes = 0; // getBytes of every chunk in chunkMatrices1, updated as chunks are loaded, unloaded and edited
 
-    std::vector<Cube*> cubesVector;
+    ChunkGrid chunkMatrices1;
+    std::tuple<int, int, int, int, int> lastWindow = {0, 0, -1, 0, 0}; // player chunk, render distance and prefetch offset of the last call
+    ChunkCache cachedChunkMatrices2; // unloaded chunks
+    std::set<std::pair<int, int>> modifiedChunks; // loaded chunks changed by setBlock, the cache keeps track of unloaded ones
 
-    int getRandomInt();
-    int counter;
 
 
-    // Takes in the camera position and gets the height of the terrain at that point.
-    int getGroundHeight(glm::vec3 position);
+    // World block coordinates are chunk * chunkSize + local index, z is the local index. Gameplay reads
+    // blocks through a WorldView, these are the same queries.
+    int getBlockID(int worldX, int worldY, int z) const;
+    bool isSolid(int worldX, int worldY, int z) const;
+    // Changes one block of a loaded chunk, false when the chunk is not loaded or z is outside the column.
+    bool setBlock(glm::ivec3 block, int id);
+    static glm::vec3 getBlockCenter(int worldX, int worldY, int z);
 };
 
 #endif // TERRAINGENERATOR_H
@@ -0,0 +1,39 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+#include <atomic>
+
+// Hands values from one writer thread to one reader thread without locking. The writer fills
+// getWriteBuffer() and publishes it, the reader always gets the newest published value. Neither
+// side ever waits, values the reader was too slow to see are simply skipped.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side
+    T &getWriteBuffer() { return m_buffers[m_writeIndex]; }
+
+    void publish() {
+        int previous = m_middle.exchange(m_writeIndex | freshBit, std::memory_order_acq_rel);
+        m_writeIndex = previous & indexMask;
+    }
+
+    // Reader side, returns the same value as last time when nothing new was published.
+    const T &acquire() {
+        if (m_middle.load(std::memory_order_relaxed) & freshBit) {
+            int previous = m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+            m_readIndex = previous & indexMask;
+        }
+        return m_buffers[m_readIndex];
+    }
+
+private:
+    static const int indexMask = 3;
+    static const int freshBit = 4; // set while the middle buffer holds a value the reader has not taken
+
+    T m_buffers[3];
+    std::atomic<int> m_middle{1};
+    int m_writeIndex = 0; // only touched by the writer
+    int m_readIndex = 2;  // only touched by the reader
+};
+
+#endif // TRIPLEBUFFER_H
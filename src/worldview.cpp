@@ -0,0 +1,45 @@
+#include "worldview.h"
+#include <cassert>
+#include "terraingenerator.h"
+
+void WorldView::getBlocks(std::span<const glm::ivec3> blocks, std::span<int> ids) const {
+    assert(ids.size() >= blocks.size());
+    std::pair<int, int> chunkKey;
+    const ChunkBlocks *chunk = nullptr;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        glm::ivec3 block = blocks[i];
+        if (i == 0 || getChunkKey(block) != chunkKey) {
+            chunkKey = getChunkKey(block);
+            chunk = m_chunks.find(chunkKey);
+        }
+        ids[i] = chunk ? chunk->get(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z) : -1;
+    }
+}
+
+void WorldView::isSolid(std::span<const glm::ivec3> blocks, std::span<bool> solid) const {
+    assert(solid.size() >= blocks.size());
+    std::pair<int, int> chunkKey;
+    const ChunkBlocks *chunk = nullptr;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        glm::ivec3 block = blocks[i];
+        if (i == 0 || getChunkKey(block) != chunkKey) {
+            chunkKey = getChunkKey(block);
+            chunk = m_chunks.find(chunkKey);
+        }
+        solid[i] = chunk && chunk->isSolid(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z);
+    }
+}
+
+bool WorldView::isAnySolid(std::span<const glm::ivec3> blocks) const {
+    for (glm::ivec3 block : blocks) {
+        if (isSolid(block)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+glm::ivec3 WorldView::getBlockAt(glm::vec3 position) {
+    // Blocks are unit cubes around their centers, and the centers are the block grid moved by the center of block 0
+    return glm::ivec3(glm::floor(position - TerrainGenerator::getBlockCenter(0, 0, 0) + 0.5f));
+}
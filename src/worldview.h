@@ -0,0 +1,62 @@
+#ifndef WORLDVIEW_H
+#define WORLDVIEW_H
+#include <bit>
+#include <span>
+#include <glm/glm.hpp>
+#include "chunkgrid.h"
+
+// Read-only access to the loaded blocks by world block coordinate, x and y are chunk * chunkSize plus
+// the index inside the chunk and z is the index in the column. Finding the chunk is a shift and a
+// grid slot, finding the block a section and a bit lookup, so every query takes constant time and
+// never allocates. Blocks of chunks that are not loaded read as air, isLoaded tells them apart.
+class WorldView
+{
+public:
+    static constexpr int chunkSize = ChunkColumn::sectionWidth;
+    static_assert((chunkSize & (chunkSize - 1)) == 0, "chunk coordinates are found with shifts");
+    static constexpr int chunkShift = std::countr_zero(unsigned(chunkSize));
+
+    explicit WorldView(const ChunkGrid &chunks) : m_chunks(chunks) {}
+
+    // -1 for air.
+    int getBlock(glm::ivec3 block) const {
+        const ChunkBlocks *chunk = findChunk(block);
+        return chunk ? chunk->get(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z) : -1;
+    }
+    bool isSolid(glm::ivec3 block) const {
+        const ChunkBlocks *chunk = findChunk(block);
+        return chunk && chunk->isSolid(block.x & (chunkSize - 1), block.y & (chunkSize - 1), block.z);
+    }
+    bool isLoaded(glm::ivec3 block) const { return findChunk(block) != nullptr; }
+    // Section holding the block, nullptr where there are no blocks at all: unloaded chunks, below the
+    // world and above the highest section of the column.
+    const ChunkSection *findSection(glm::ivec3 block) const {
+        const ChunkBlocks *chunk = findChunk(block);
+        if (chunk == nullptr || block.z < 0 || block.z >= chunk->getSectionCount() * ChunkColumn::sectionHeight) {
+            return nullptr;
+        }
+        return &chunk->getSection(block.z / ChunkColumn::sectionHeight);
+    }
+
+    // The same for many blocks, into the matching element of the output. Runs of blocks in the same
+    // chunk look the chunk up once.
+    void getBlocks(std::span<const glm::ivec3> blocks, std::span<int> ids) const;
+    void isSolid(std::span<const glm::ivec3> blocks, std::span<bool> solid) const;
+    // True if any of the blocks is solid, stops at the first.
+    bool isAnySolid(std::span<const glm::ivec3> blocks) const;
+
+    // Chunk holding the block, rounding down for negative coordinates.
+    static std::pair<int, int> getChunkKey(glm::ivec3 block) {
+        // >> rounds towards negative infinity, unlike /
+        return {block.x >> chunkShift, block.y >> chunkShift};
+    }
+    // Block containing a point in world space, the inverse of TerrainGenerator::getBlockCenter.
+    static glm::ivec3 getBlockAt(glm::vec3 position);
+
+private:
+    const ChunkBlocks *findChunk(glm::ivec3 block) const { return m_chunks.find(getChunkKey(block)); }
+
+    const ChunkGrid &m_chunks;
+};
+
+#endif // WORLDVIEW_H